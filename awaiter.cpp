@@ -11,6 +11,7 @@
 #include "coroutine.hpp"
 #include "task/task_awaiter.hpp"
 #include "thread_pool.hpp"
+#include "timer/sleep.hpp"
 
 namespace Levelz::Async {
 
@@ -18,6 +19,7 @@ Awaiter::Awaiter(Coroutine& coroutine, AwaiterKind kind) noexcept
     : m_coroutine { coroutine }
     , m_kind { kind }
     , m_maybeBlocked { false }
+    , m_isTimedOut { false }
 {
 }
 
@@ -33,9 +35,11 @@ Awaiter::SuspensionAdvice Awaiter::onSuspend(std::coroutine_handle<> handle)
         ThreadPool::setCurrentCoroutine(nullptr);
 
     assert(handle == m_coroutine.m_handle);
+    if (!isFinalAwaiter)
+        ThreadPool::recordRunTime(m_coroutine);
     auto isCancelled = m_coroutine.isCancelled();
     auto shouldCancelAbandoned = m_coroutine.shouldCancelAbandoned();
-    auto threadPoolKind = m_coroutine.threadPoolKind();
+    auto* threadPool = &m_coroutine.threadPool();
 
     auto status = m_coroutine.setStatus(CoroutineStatus::Suspended, isFinalAwaiter);
 
@@ -44,10 +48,10 @@ Awaiter::SuspensionAdvice Awaiter::onSuspend(std::coroutine_handle<> handle)
         return SuspensionAdvice::shouldNotSuspend;
     }
 
-    if (!isFinalAwaiter && threadPoolKind != ThreadPool::currentThreadPoolKind())
+    if (!isFinalAwaiter && threadPool != ThreadPool::currentThreadPool())
         return SuspensionAdvice::shouldSuspend;
 
-    if (!ThreadPool::canDoChainedExecution())
+    if (!ThreadPool::canDoChainedExecution() || ThreadPool::isTurnOver())
         return SuspensionAdvice::shouldSuspend;
 
     if (!isFinalAwaiter && status == CoroutineStatus::Abandoned && shouldCancelAbandoned)
@@ -61,7 +65,7 @@ Awaiter::SuspensionAdvice Awaiter::onSuspend(std::coroutine_handle<> handle)
 
 void Awaiter::onResume()
 {
-    assert(coroutine().threadPoolKind() == ThreadPool::currentThreadPoolKind());
+    assert(&coroutine().threadPool() == ThreadPool::currentThreadPool());
 
     if (kind() != AwaiterKind::Final && kind() != AwaiterKind::Initial && kind() != AwaiterKind::Yield)
         coroutine().removeAwaiter(this);
@@ -89,12 +93,13 @@ void Awaiter::onResume()
 
 Awaiter::SuspensionAdvice Awaiter::onReady()
 {
-    if (ThreadPool::currentThreadPool())
-        ThreadPool::currentThreadPool()->processPendingWakeUps();
-
     auto isFinalAwaiter = kind() == AwaiterKind::Final;
     if (isFinalAwaiter)
         ThreadPool::setCurrentCoroutine(nullptr);
+    else if (kind() != AwaiterKind::Initial && m_coroutine.isPastDeadline())
+        m_coroutine.cancel();
+    else if (kind() != AwaiterKind::Initial && m_coroutine.hasDeadline())
+        m_coroutine.armDeadlineTimer();
 
     if (kind() != AwaiterKind::Final && kind() != AwaiterKind::Initial && kind() != AwaiterKind::Yield)
         coroutine().addAwaiter(this);
@@ -104,10 +109,10 @@ Awaiter::SuspensionAdvice Awaiter::onReady()
         return SuspensionAdvice::shouldNotSuspend;
     }
 
-    if (coroutine().threadPoolKind() != ThreadPool::currentThreadPoolKind())
+    if (&coroutine().threadPool() != ThreadPool::currentThreadPool())
         return SuspensionAdvice::shouldSuspend;
 
-    if (!ThreadPool::canDoChainedExecution())
+    if (!ThreadPool::canDoChainedExecution() || ThreadPool::isTurnOver())
         return SuspensionAdvice::shouldSuspend;
 
     if (!isFinalAwaiter && m_coroutine.status() == CoroutineStatus::Abandoned && m_coroutine.shouldCancelAbandoned())
@@ -147,17 +152,45 @@ bool Awaiter::cancel(Awaiter* awaiter) noexcept
         return static_cast<AsyncBarrier::AsyncBarrierAwaiter*>(awaiter)->cancel();
     case AwaiterKind::Task:
         return static_cast<TaskAwaiterBase*>(awaiter)->cancel();
+    case AwaiterKind::Timer:
+        return static_cast<SleepAwaiter*>(awaiter)->cancel();
     default:
         break;
     }
     return false;
 }
 
+// Ends a single blocked wait through the awaiter's cancel path without
+// cancelling the coroutine. Returns false if the awaiter is not blocked yet
+// or was already woken up.
+bool Awaiter::timeOut(Awaiter* awaiter) noexcept
+{
+    auto& coroutine = awaiter->coroutine();
+    if (!awaiter->maybeBlocked() || !coroutine.tryPause())
+        return false;
+
+    awaiter->m_isTimedOut = true;
+    auto timedOut = cancel(awaiter);
+    if (!timedOut)
+        awaiter->m_isTimedOut = false;
+
+    auto prevStatus = coroutine.setStatus(CoroutineStatus::Resumed);
+    (void)prevStatus;
+    assert(prevStatus == CoroutineStatus::PauseOnRunning
+        || prevStatus == CoroutineStatus::Paused);
+    return timedOut;
+}
+
 bool Awaiter::maybeBlocked() const noexcept
 {
     return m_maybeBlocked;
 }
 
+bool Awaiter::isTimedOut() const noexcept
+{
+    return m_isTimedOut;
+}
+
 void Awaiter::setMaybeBlocked(bool maybeBlocked) noexcept
 {
     m_maybeBlocked = maybeBlocked;
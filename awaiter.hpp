@@ -30,7 +30,9 @@ struct Awaiter {
     [[nodiscard]] Awaiter* next() const noexcept;
     [[nodiscard]] AwaiterKind kind() const noexcept;
     static bool cancel(Awaiter* awaiter) noexcept;
+    static bool timeOut(Awaiter* awaiter) noexcept;
     bool maybeBlocked() const noexcept;
+    bool isTimedOut() const noexcept;
 
 protected:
     void setMaybeBlocked(bool maybeBlocked) noexcept;
@@ -40,6 +42,7 @@ private:
     std::atomic<Awaiter*> m_next;
     const AwaiterKind m_kind;
     std::atomic<bool> m_maybeBlocked;
+    std::atomic<bool> m_isTimedOut;
 };
 
 }
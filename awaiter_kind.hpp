@@ -16,7 +16,9 @@ enum class AwaiterKind {
     Event,
     Value,
     Barrier,
-    ThreadPool
+    ThreadPool,
+    Timer,
+    Blocking
 };
 
 }
@@ -0,0 +1,99 @@
+#ifndef LEVELZ_BLOCKING_AWAITER_HPP
+#define LEVELZ_BLOCKING_AWAITER_HPP
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "awaiter.hpp"
+#include "coroutine.hpp"
+#include "thread_pool.hpp"
+
+namespace Levelz::Async {
+
+// co_await runBlocking(function) calls a blocking function on the current
+// thread while a spare thread takes over its worker, then continues the
+// coroutine on the pool. Past the pool's spare limit the worker blocks in place.
+template <typename Function>
+struct Blocking {
+    Function function;
+};
+
+template <typename Function>
+Blocking<std::decay_t<Function>> runBlocking(Function&& function)
+{
+    return { std::forward<Function>(function) };
+}
+
+template <typename Function>
+struct BlockingAwaiter : Awaiter {
+    using ValueType = std::invoke_result_t<Function&>;
+    static_assert(!std::is_reference_v<ValueType>);
+
+    BlockingAwaiter(Function&& function, Coroutine& coroutine) noexcept
+        : Awaiter { coroutine, AwaiterKind::Blocking }
+        , m_function { std::move(function) }
+        , m_value {}
+        , m_exception {}
+    {
+    }
+
+    BlockingAwaiter(const BlockingAwaiter&) = delete;
+    BlockingAwaiter& operator=(const BlockingAwaiter&) = delete;
+    BlockingAwaiter(BlockingAwaiter&&) = delete;
+    BlockingAwaiter& operator=(BlockingAwaiter&&) = delete;
+
+    bool await_ready() noexcept
+    {
+        auto suspensionAdvice = Awaiter::onReady();
+        if (suspensionAdvice == Awaiter::SuspensionAdvice::shouldNotSuspend)
+            return true;
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> awaitingCoroutine) noexcept
+    {
+        auto suspensionAdvice = Awaiter::onSuspend(awaitingCoroutine);
+        if (suspensionAdvice == Awaiter::SuspensionAdvice::shouldNotSuspend)
+            return false;
+
+        auto handedOff = ThreadPool::handOffWorker();
+        try {
+            if constexpr (std::is_void_v<ValueType>) {
+                m_function();
+                m_value.emplace();
+            } else {
+                m_value.emplace(m_function());
+            }
+        } catch (...) {
+            m_exception = std::current_exception();
+        }
+
+        // the thread no longer belongs to the pool, the coroutine goes back to it
+        if (!handedOff && suspensionAdvice == Awaiter::SuspensionAdvice::maySuspend)
+            return false;
+        coroutine().schedule();
+        return true;
+    }
+
+    ValueType await_resume()
+    {
+        Awaiter::onResume();
+        if (m_exception)
+            std::rethrow_exception(m_exception);
+        if constexpr (!std::is_void_v<ValueType>)
+            return std::move(*m_value);
+    }
+
+private:
+    Function m_function;
+    std::optional<std::conditional_t<std::is_void_v<ValueType>, std::monostate, ValueType>> m_value;
+    std::exception_ptr m_exception;
+};
+
+}
+
+#endif // LEVELZ_BLOCKING_AWAITER_HPP
@@ -65,20 +65,27 @@ struct ConcurrentFifoList {
 
     void enqueue(ListNode* node) noexcept
     {
-        node->setNext(nullptr);
+        enqueueChain(node, node, 1);
+    }
+
+    // Enqueues count nodes already linked from first to last with a single exchange
+    void enqueueChain(ListNode* first, ListNode* last, uint64_t count) noexcept
+    {
+        assert(first && last && count > 0);
+        last->setNext(nullptr);
 
-        auto* oldTail = m_tail.exchange(node);
+        auto* oldTail = m_tail.exchange(last);
 
         if (oldTail) {
             assert(!oldTail->next());
-            oldTail->setNext(node);
+            oldTail->setNext(first);
         } else {
             assert(!m_head);
-            auto* oldHead = m_head.exchange(node);
+            auto* oldHead = m_head.exchange(first);
             assert(!oldHead);
             (void)oldHead;
         }
-        m_count++;
+        m_count += count;
     }
 
     bool isEmpty() const noexcept
@@ -3,13 +3,17 @@
 //
 
 #include <cassert>
+#include <new>
 
 #include "coroutine.hpp"
 #include "thread_pool.hpp"
+#include "timer/timer_service.hpp"
+#include "work_item.hpp"
 
 namespace Levelz::Async {
 
-Coroutine::Coroutine(std::coroutine_handle<> handle, bool cancelAbandoned, TaskKind taskKind, ThreadPoolKind threadPoolKind) noexcept
+Coroutine::Coroutine(std::coroutine_handle<> handle, bool cancelAbandoned, TaskKind taskKind,
+    ThreadPoolKind threadPoolKind, ThreadPool* threadPool) noexcept
     : m_next { nullptr }
     , m_handle { handle }
     , m_status { CoroutineStatus::NotStarted }
@@ -17,7 +21,14 @@ Coroutine::Coroutine(std::coroutine_handle<> handle, bool cancelAbandoned, TaskK
     , m_cancelAbandoned { cancelAbandoned }
     , m_owner { nullptr }
     , m_awaiters {}
-    , m_threadPoolKind { determineThreadPoolKind(threadPoolKind) }
+    , m_threadPool { &determineThreadPool(threadPoolKind, threadPool) }
+    , m_longRunCount { 0 }
+    , m_isThreadPoolPinned { threadPoolKind != ThreadPoolKind::Current || threadPool }
+    , m_priority { currentPriority() }
+    , m_deadline { currentDeadline() }
+    , m_deadlineChild { nullptr }
+    , m_deadlineTimer { nullptr }
+    , m_armedDeadline { std::chrono::steady_clock::time_point::max() }
 #ifdef DEBUG
     , m_taskKind { taskKind }
     , m_completionEvent {}
@@ -25,9 +36,17 @@ Coroutine::Coroutine(std::coroutine_handle<> handle, bool cancelAbandoned, TaskK
 {
 }
 
+thread_local Priority Coroutine::s_threadPriority = Priority::Normal;
+thread_local std::chrono::steady_clock::time_point Coroutine::s_threadDeadline
+    = std::chrono::steady_clock::time_point::max();
+
 Coroutine::~Coroutine()
 {
     assert(ThreadPool::currentCoroutine() != this);
+    if (m_deadlineTimer) {
+        TimerService::instance().disarm(*m_deadlineTimer);
+        delete m_deadlineTimer;
+    }
 }
 
 void Coroutine::setNext(Coroutine* next) noexcept
@@ -48,14 +67,19 @@ std::coroutine_handle<> Coroutine::handle() noexcept
 void Coroutine::resume()
 {
     assert(ThreadPool::canDoChainedExecution());
+    // a work item has no frame, it runs its callable and frees itself
+    if (!m_handle) {
+        static_cast<WorkItem*>(this)->run();
+        return;
+    }
     assert(!m_handle.done());
     m_handle.resume();
 }
 
 void Coroutine::schedule() noexcept
 {
-    assert(!m_handle.done());
-    ThreadPool::threadPool(threadPoolKind()).scheduleOnThreadPool(this);
+    assert(!m_handle || !m_handle.done());
+    m_threadPool.load()->scheduleOnThreadPool(this);
 }
 
 bool Coroutine::validate() const noexcept
@@ -348,32 +372,58 @@ void Coroutine::cancel() noexcept
     if (m_cancelled)
         return;
     m_cancelled = true;
+    cancelAwaiters();
+}
 
+// Ends the blocked waits of a suspended coroutine. Returns false when a wait
+// was caught before it blocked; it stays on the list and may block after this
+// returns, so the caller tries again.
+bool Coroutine::cancelAwaiters() noexcept
+{
     if (status() != CoroutineStatus::Suspended)
-        return;
+        return true;
 
     if (m_awaiters.isEmpty())
-        return;
+        return true;
 
-    auto prevStatus = setStatus(CoroutineStatus::PauseOnRunning);
-    if (prevStatus != CoroutineStatus::Suspended)
-        return;
+    if (!tryPause())
+        return true;
 
+    Awaiter* notBlocked = nullptr;
     bool foundBlockingAwaiter;
     do {
         foundBlockingAwaiter = false;
         while (auto* awaiter = m_awaiters.dequeue()) {
-            if (!awaiter->maybeBlocked())
+            if (!awaiter->maybeBlocked()) {
+                awaiter->setNext(notBlocked);
+                notBlocked = awaiter;
                 continue;
+            }
             auto cancelled = Awaiter::cancel(awaiter);
             foundBlockingAwaiter = foundBlockingAwaiter || !cancelled;
         }
     } while (foundBlockingAwaiter && status() != CoroutineStatus::Paused);
 
-    prevStatus = setStatus(CoroutineStatus::Resumed);
+    auto isDone = !notBlocked;
+    while (notBlocked) {
+        auto* awaiter = notBlocked;
+        notBlocked = awaiter->next();
+        m_awaiters.enqueue(awaiter);
+    }
+
+    auto prevStatus = setStatus(CoroutineStatus::Resumed);
     (void)prevStatus;
     assert(prevStatus == CoroutineStatus::PauseOnRunning
         || prevStatus == CoroutineStatus::Paused);
+    return isDone;
+}
+
+// Keeps a suspended coroutine from running while its awaiters are cancelled,
+// setStatus(Resumed) lets it go again
+bool Coroutine::tryPause() noexcept
+{
+    auto expectedStatus = CoroutineStatus::Suspended;
+    return m_status.compare_exchange_strong(expectedStatus, CoroutineStatus::PauseOnRunning);
 }
 
 bool Coroutine::shouldCancelAbandoned() const noexcept
@@ -469,19 +519,32 @@ void Coroutine::setCancelled() noexcept
 
 ThreadPoolKind Coroutine::threadPoolKind() const noexcept
 {
-    return m_threadPoolKind;
+    return m_threadPool.load()->kind();
 }
 
-ThreadPoolKind Coroutine::determineThreadPoolKind(ThreadPoolKind requestedThreadPoolKind) noexcept
+ThreadPool& Coroutine::threadPool() const noexcept
+{
+    return *m_threadPool.load();
+}
+
+void Coroutine::setThreadPool(ThreadPool& threadPool, bool isPinned) noexcept
+{
+    m_threadPool.store(&threadPool);
+    m_isThreadPoolPinned = isPinned;
+}
+
+ThreadPool& Coroutine::determineThreadPool(ThreadPoolKind requestedThreadPoolKind, ThreadPool* requestedThreadPool) noexcept
 {
     if (requestedThreadPoolKind == ThreadPoolKind::Current) {
+        if (requestedThreadPool)
+            return *requestedThreadPool;
         if (Coroutine::currentCoroutine())
-            return Coroutine::currentCoroutine()->threadPoolKind();
+            return Coroutine::currentCoroutine()->threadPool();
         if (ThreadPool::currentThreadPool())
-            return ThreadPool::currentThreadPool()->kind();
-        return ThreadPoolKind::Default;
+            return *ThreadPool::currentThreadPool();
+        return ThreadPool::defaultThreadPool();
     }
-    return requestedThreadPoolKind;
+    return ThreadPool::threadPool(requestedThreadPoolKind);
 }
 
 ThreadPoolKind Coroutine::currentThreadPoolKind() noexcept
@@ -498,4 +561,87 @@ void Coroutine::addWaitingOnCompletion(Coroutine* coroutine) noexcept
 
 #endif
 
+Priority Coroutine::priority() const noexcept
+{
+    return m_priority.load(std::memory_order_relaxed);
+}
+
+void Coroutine::setPriority(Priority priority) noexcept
+{
+    m_priority.store(priority, std::memory_order_relaxed);
+}
+
+Priority Coroutine::currentPriority() noexcept
+{
+    if (currentCoroutine())
+        return currentCoroutine()->priority();
+    return s_threadPriority;
+}
+
+void Coroutine::setCurrentPriority(Priority priority) noexcept
+{
+    if (currentCoroutine())
+        currentCoroutine()->setPriority(priority);
+    else
+        s_threadPriority = priority;
+}
+
+std::chrono::steady_clock::time_point Coroutine::deadline() const noexcept
+{
+    return m_deadline.load(std::memory_order_relaxed);
+}
+
+void Coroutine::setDeadline(std::chrono::steady_clock::time_point deadline) noexcept
+{
+    m_deadline.store(deadline, std::memory_order_relaxed);
+}
+
+bool Coroutine::hasDeadline() const noexcept
+{
+    return deadline() != std::chrono::steady_clock::time_point::max();
+}
+
+bool Coroutine::isPastDeadline() const noexcept
+{
+    return hasDeadline() && std::chrono::steady_clock::now() >= deadline();
+}
+
+// A coroutine blocked on an event, mutex or value reaches no await point to
+// notice its deadline, the timer cancels it instead. Rearmed when the deadline
+// moved since it was armed. Without memory for the timer the deadline is only
+// checked at await points.
+void Coroutine::armDeadlineTimer() noexcept
+{
+    auto deadline = this->deadline();
+    if (deadline == m_armedDeadline)
+        return;
+
+    auto& timerService = TimerService::instance();
+    if (m_deadlineTimer)
+        timerService.disarm(*m_deadlineTimer);
+    else {
+        m_deadlineTimer = new (std::nothrow) CoroutineTimer { *this, TimerAction::Cancel };
+        if (!m_deadlineTimer)
+            return;
+    }
+    m_armedDeadline = deadline;
+    // a passed deadline was already caught by the caller
+    (void)timerService.arm(*m_deadlineTimer, deadline);
+}
+
+std::chrono::steady_clock::time_point Coroutine::currentDeadline() noexcept
+{
+    if (currentCoroutine())
+        return currentCoroutine()->deadline();
+    return s_threadDeadline;
+}
+
+void Coroutine::setCurrentDeadline(std::chrono::steady_clock::time_point deadline) noexcept
+{
+    if (currentCoroutine())
+        currentCoroutine()->setDeadline(deadline);
+    else
+        s_threadDeadline = deadline;
+}
+
 }
@@ -6,12 +6,14 @@
 #define LEVELZ_COROUTINE_HPP
 
 #include <atomic>
+#include <chrono>
 #include <coroutine>
 #ifdef DEBUG
 #include <vector>
 #endif
 
 #include "event/async_countdown_event.hpp"
+#include "priority.hpp"
 #include "task_kind.hpp"
 #include "thread_pool_kind.hpp"
 #include "awaiter_kind.hpp"
@@ -19,6 +21,9 @@
 
 namespace Levelz::Async {
 
+struct CoroutineTimer;
+struct ThreadPool;
+
 enum class CoroutineStatus {
     NotStarted,
     Running,
@@ -58,7 +63,19 @@ struct Coroutine {
     static Coroutine* currentCoroutine() noexcept;
     void setCancelAbandoned(bool cancelAbandoned) noexcept;
     ThreadPoolKind threadPoolKind() const noexcept;
+    ThreadPool& threadPool() const noexcept;
     static ThreadPoolKind currentThreadPoolKind() noexcept;
+    Priority priority() const noexcept;
+    void setPriority(Priority priority) noexcept;
+    static Priority currentPriority() noexcept;
+    static void setCurrentPriority(Priority priority) noexcept;
+    // time_point::max() when there is no deadline
+    std::chrono::steady_clock::time_point deadline() const noexcept;
+    void setDeadline(std::chrono::steady_clock::time_point deadline) noexcept;
+    bool hasDeadline() const noexcept;
+    bool isPastDeadline() const noexcept;
+    static std::chrono::steady_clock::time_point currentDeadline() noexcept;
+    static void setCurrentDeadline(std::chrono::steady_clock::time_point deadline) noexcept;
     AsyncCountDownEvent& completionEvent() noexcept;
     void setNext(Coroutine* nextOp) noexcept;
     Coroutine* next() const noexcept;
@@ -84,19 +101,29 @@ private:
     template <typename>
     friend struct BaseTask;
     friend struct TaskAwaiterBase;
+    friend struct WorkItem;
+    friend struct DeadlineQueue;
+    friend struct ResumeOnAwaiter;
+    friend struct ResumeOnScope;
+    friend struct TimerService;
 
     void resume();
     CoroutineStatus setStatus(CoroutineStatus status, bool isFinalAwaiter = false) noexcept;
     void justSetStatus(CoroutineStatus newStatus, CoroutineStatus expectedCurrentStatus) noexcept;
-    Coroutine(std::coroutine_handle<> coroutine, bool cancelAbandoned, TaskKind taskKind, ThreadPoolKind threadPoolKind) noexcept;
+    bool tryPause() noexcept;
+    bool cancelAwaiters() noexcept;
+    void armDeadlineTimer() noexcept;
+    Coroutine(std::coroutine_handle<> coroutine, bool cancelAbandoned, TaskKind taskKind,
+        ThreadPoolKind threadPoolKind, ThreadPool* threadPool = nullptr) noexcept;
     std::coroutine_handle<> handle() noexcept;
-    static ThreadPoolKind determineThreadPoolKind(ThreadPoolKind requestedThreadPoolKind) noexcept;
+    static ThreadPool& determineThreadPool(ThreadPoolKind requestedThreadPoolKind, ThreadPool* requestedThreadPool) noexcept;
     void setOwner(Coroutine* newOwnerCoroutine) noexcept;
     void signalOwner() noexcept;
     void setOwner() noexcept;
     void clearOwner() noexcept;
     void addAwaiter(Awaiter* awaiter) noexcept;
     void removeAwaiter(Awaiter* awaiter) noexcept;
+    void setThreadPool(ThreadPool& threadPool, bool isPinned = true) noexcept;
 
     std::atomic<CoroutineStatus> m_status;
     std::atomic<bool> m_cancelled;
@@ -106,7 +133,25 @@ private:
     AsyncCountDownEvent m_completionEvent;
     std::atomic<Coroutine*> m_owner;
     ConcurrentFifoList<Awaiter> m_awaiters;
-    const ThreadPoolKind m_threadPoolKind;
+    // changed only by the coroutine's own thread while it runs
+    std::atomic<ThreadPool*> m_threadPool;
+    // consecutive resumptions that ran past the pool's migration threshold
+    int m_longRunCount;
+    // the pool was chosen explicitly, through its kind, RunOn or resumeOn, and
+    // migration leaves the coroutine there. Changed like m_threadPool.
+    bool m_isThreadPoolPinned;
+    std::atomic<Priority> m_priority;
+    std::atomic<std::chrono::steady_clock::time_point> m_deadline;
+    // first child while queued in the pool's deadline heap, siblings link through m_next
+    Coroutine* m_deadlineChild;
+    // cancels the coroutine when its deadline passes while it waits, created
+    // at its first await with a deadline
+    CoroutineTimer* m_deadlineTimer;
+    // what m_deadlineTimer was armed for, changed like m_deadline
+    std::chrono::steady_clock::time_point m_armedDeadline;
+
+    static thread_local Priority s_threadPriority;
+    static thread_local std::chrono::steady_clock::time_point s_threadDeadline;
 #ifdef DEBUG
     // m_waitingOnCompletions's Coroutine pointers may be invalid
     std::vector<Coroutine*> m_waitingOnCompletions;
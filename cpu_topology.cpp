@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "cpu_topology.hpp"
+
+namespace Levelz::Async {
+
+namespace {
+    const std::filesystem::path s_sysCpuPath { "/sys/devices/system/cpu" };
+
+    int readFirstInt(const std::filesystem::path& path, int defaultValue)
+    {
+        std::ifstream file { path };
+        int value;
+        if (file >> value)
+            return value;
+        return defaultValue;
+    }
+}
+
+std::vector<CpuTopology::Cpu> CpuTopology::cpus(const std::vector<int>& cpuSet)
+{
+    std::vector<Cpu> cpus;
+    for (auto id : cpuSet.empty() ? availableCpus() : cpuSet)
+        cpus.push_back(Cpu { .id = id, .numaNode = numaNode(id), .cacheDomain = cacheDomain(id) });
+
+    std::sort(cpus.begin(), cpus.end(), [](const Cpu& a, const Cpu& b) {
+        if (a.numaNode != b.numaNode)
+            return a.numaNode < b.numaNode;
+        if (a.cacheDomain != b.cacheDomain)
+            return a.cacheDomain < b.cacheDomain;
+        return a.id < b.id;
+    });
+    cpus.erase(std::unique(cpus.begin(), cpus.end(), [](const Cpu& a, const Cpu& b) {
+        return a.id == b.id;
+    }),
+        cpus.end());
+    return cpus;
+}
+
+bool CpuTopology::setCurrentThreadAffinity(const std::vector<int>& cpuSet) noexcept
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpuSet) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    // macOS only exposes affinity hints through thread_policy_set
+    (void)cpuSet;
+    return false;
+#endif
+}
+
+std::vector<int> CpuTopology::availableCpus()
+{
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+#endif
+    for (int cpu = 0; cpu < static_cast<int>(std::thread::hardware_concurrency()); ++cpu)
+        cpus.push_back(cpu);
+    return cpus;
+}
+
+int CpuTopology::numaNode(int cpu)
+{
+    std::error_code error;
+    auto cpuPath = s_sysCpuPath / ("cpu" + std::to_string(cpu));
+    for (const auto& entry : std::filesystem::directory_iterator { cpuPath, error }) {
+        auto name = entry.path().filename().string();
+        if (name.size() > 4 && name.starts_with("node"))
+            return std::stoi(name.substr(4));
+    }
+    return 0;
+}
+
+int CpuTopology::cacheDomain(int cpu)
+{
+    // The highest level cache index is the last level cache, its domain is
+    // identified by the lowest cpu sharing it.
+    std::error_code error;
+    auto cachePath = s_sysCpuPath / ("cpu" + std::to_string(cpu)) / "cache";
+    int maxLevel = 0;
+    int domain = cpu;
+    for (const auto& entry : std::filesystem::directory_iterator { cachePath, error }) {
+        if (!entry.path().filename().string().starts_with("index"))
+            continue;
+        int level = readFirstInt(entry.path() / "level", 0);
+        if (level <= maxLevel)
+            continue;
+        maxLevel = level;
+        domain = readFirstInt(entry.path() / "shared_cpu_list", cpu);
+    }
+    return domain;
+}
+
+}
@@ -0,0 +1,29 @@
+#ifndef LEVELZ_CPU_TOPOLOGY_HPP
+#define LEVELZ_CPU_TOPOLOGY_HPP
+
+#include <vector>
+
+namespace Levelz::Async {
+
+struct CpuTopology {
+    struct Cpu {
+        int id;
+        int numaNode;
+        // cpus sharing the last level cache share a cache domain
+        int cacheDomain;
+    };
+
+    // Cpus of cpuSet (or all cpus the process may run on when empty) ordered by
+    // NUMA node and cache domain so neighbouring entries share caches.
+    static std::vector<Cpu> cpus(const std::vector<int>& cpuSet);
+    static bool setCurrentThreadAffinity(const std::vector<int>& cpuSet) noexcept;
+
+private:
+    static std::vector<int> availableCpus();
+    static int numaNode(int cpu);
+    static int cacheDomain(int cpu);
+};
+
+}
+
+#endif // LEVELZ_CPU_TOPOLOGY_HPP
@@ -0,0 +1,109 @@
+#include <utility>
+
+#include "coroutine.hpp"
+#include "deadline_queue.hpp"
+
+namespace Levelz::Async {
+
+DeadlineQueue::DeadlineQueue() noexcept
+    : m_mutex {}
+    , m_root { nullptr }
+    , m_count { 0 }
+    , m_earliestDeadline { std::chrono::steady_clock::time_point::max() }
+{
+}
+
+// A coroutine's deadline only changes while it runs, never while it is queued
+void DeadlineQueue::enqueue(Coroutine* coroutine) noexcept
+{
+    coroutine->setNext(nullptr);
+    coroutine->m_deadlineChild = nullptr;
+    std::unique_lock lock { m_mutex };
+    m_root = meld(m_root, coroutine);
+    m_count++;
+    m_earliestDeadline.store(m_root->deadline(), std::memory_order_relaxed);
+}
+
+void DeadlineQueue::enqueueChain(Coroutine* first, uint64_t count) noexcept
+{
+    std::unique_lock lock { m_mutex };
+    for (uint64_t i = 0; i < count; ++i) {
+        auto* coroutine = first;
+        first = first->next();
+        coroutine->setNext(nullptr);
+        coroutine->m_deadlineChild = nullptr;
+        m_root = meld(m_root, coroutine);
+    }
+    m_count += count;
+    m_earliestDeadline.store(m_root->deadline(), std::memory_order_relaxed);
+}
+
+Coroutine* DeadlineQueue::dequeue() noexcept
+{
+    if (isEmpty())
+        return nullptr;
+
+    std::unique_lock lock { m_mutex };
+    auto* coroutine = m_root;
+    if (!coroutine)
+        return nullptr;
+    m_root = mergeChildren(coroutine->m_deadlineChild);
+    coroutine->m_deadlineChild = nullptr;
+    m_count--;
+    m_earliestDeadline.store(m_root ? m_root->deadline() : std::chrono::steady_clock::time_point::max(),
+        std::memory_order_relaxed);
+    return coroutine;
+}
+
+bool DeadlineQueue::isEmpty() const noexcept
+{
+    return m_count == 0;
+}
+
+std::chrono::steady_clock::time_point DeadlineQueue::earliestDeadline() const noexcept
+{
+    return m_earliestDeadline.load(std::memory_order_relaxed);
+}
+
+// Both are roots, the later deadline becomes the first child of the earlier one
+Coroutine* DeadlineQueue::meld(Coroutine* first, Coroutine* second) noexcept
+{
+    if (!first)
+        return second;
+    if (!second)
+        return first;
+    if (second->deadline() < first->deadline())
+        std::swap(first, second);
+    second->setNext(first->m_deadlineChild);
+    first->m_deadlineChild = second;
+    return first;
+}
+
+// Two pass pairing: meld the children in pairs left to right, then meld the
+// pairs right to left. The pairs are kept on a stack linked through next.
+Coroutine* DeadlineQueue::mergeChildren(Coroutine* firstChild) noexcept
+{
+    Coroutine* pairs = nullptr;
+    while (firstChild) {
+        auto* first = firstChild;
+        auto* second = first->next();
+        firstChild = second ? second->next() : nullptr;
+        first->setNext(nullptr);
+        if (second)
+            second->setNext(nullptr);
+        auto* pair = meld(first, second);
+        pair->setNext(pairs);
+        pairs = pair;
+    }
+
+    Coroutine* root = nullptr;
+    while (pairs) {
+        auto* pair = pairs;
+        pairs = pair->next();
+        pair->setNext(nullptr);
+        root = meld(root, pair);
+    }
+    return root;
+}
+
+}
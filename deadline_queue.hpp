@@ -0,0 +1,41 @@
+#ifndef LEVELZ_DEADLINE_QUEUE_HPP
+#define LEVELZ_DEADLINE_QUEUE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace Levelz::Async {
+
+struct Coroutine;
+
+// Ready coroutines that have a deadline, dequeued earliest deadline first.
+// An intrusive pairing heap linked through the coroutines, so enqueueing
+// never allocates. Every worker keeps one for the deadline coroutines it
+// schedules and thieves take its earliest, the pool keeps one for those
+// scheduled from other threads.
+struct DeadlineQueue {
+    DeadlineQueue() noexcept;
+
+    void enqueue(Coroutine* coroutine) noexcept;
+    // count coroutines linked through next, under a single lock
+    void enqueueChain(Coroutine* first, uint64_t count) noexcept;
+    Coroutine* dequeue() noexcept;
+    bool isEmpty() const noexcept;
+    // time_point::max() when empty
+    std::chrono::steady_clock::time_point earliestDeadline() const noexcept;
+
+private:
+    static Coroutine* meld(Coroutine* first, Coroutine* second) noexcept;
+    static Coroutine* mergeChildren(Coroutine* firstChild) noexcept;
+
+    std::mutex m_mutex;
+    Coroutine* m_root;
+    std::atomic<uint64_t> m_count;
+    // the root's deadline, read without the lock to pick between queues
+    std::atomic<std::chrono::steady_clock::time_point> m_earliestDeadline;
+};
+
+}
+
+#endif // LEVELZ_DEADLINE_QUEUE_HPP
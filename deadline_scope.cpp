@@ -0,0 +1,24 @@
+#include <algorithm>
+
+#include "coroutine.hpp"
+#include "deadline_scope.hpp"
+
+namespace Levelz::Async {
+
+DeadlineScope::DeadlineScope(std::chrono::steady_clock::time_point deadline) noexcept
+    : m_previousDeadline { Coroutine::currentDeadline() }
+{
+    Coroutine::setCurrentDeadline(std::min(deadline, m_previousDeadline));
+}
+
+DeadlineScope::DeadlineScope(std::chrono::nanoseconds timeout) noexcept
+    : DeadlineScope { std::chrono::steady_clock::now() + timeout }
+{
+}
+
+DeadlineScope::~DeadlineScope()
+{
+    Coroutine::setCurrentDeadline(m_previousDeadline);
+}
+
+}
@@ -0,0 +1,27 @@
+#ifndef LEVELZ_DEADLINE_SCOPE_HPP
+#define LEVELZ_DEADLINE_SCOPE_HPP
+
+#include <chrono>
+
+namespace Levelz::Async {
+
+// Tightens the deadline of the current coroutine, or of the current thread
+// outside coroutines, until the end of the scope. Coroutines inherit the
+// deadline of whoever creates them and are cancelled once it passes.
+struct DeadlineScope {
+    explicit DeadlineScope(std::chrono::steady_clock::time_point deadline) noexcept;
+    explicit DeadlineScope(std::chrono::nanoseconds timeout) noexcept;
+    ~DeadlineScope();
+
+    DeadlineScope(const DeadlineScope&) = delete;
+    DeadlineScope(DeadlineScope&&) = delete;
+    DeadlineScope& operator=(const DeadlineScope&) = delete;
+    DeadlineScope& operator=(DeadlineScope&&) = delete;
+
+private:
+    const std::chrono::steady_clock::time_point m_previousDeadline;
+};
+
+}
+
+#endif // LEVELZ_DEADLINE_SCOPE_HPP
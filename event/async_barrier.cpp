@@ -3,6 +3,8 @@
 //
 
 #include "async_barrier.hpp"
+#include "schedule_batch.hpp"
+#include "spin_wait.hpp"
 
 namespace Levelz::Async {
 
@@ -31,16 +33,17 @@ bool AsyncBarrier::arriveAndWait(Coroutine* awaiter) noexcept
         return true;
     }
 
-    do {
+    while (true) {
         assert(count < m_capacity);
         if (count == m_capacity - 1) {
-            auto success = arriveAndRelease(awaiter);
-            assert(success);
-            (void)success;
-            return false;
+            if (arriveAndRelease(awaiter))
+                return false;
+            // a timed out waiter withdrew its arrival first
+            count = m_count.load();
+        } else if (m_count.compare_exchange_weak(count, count + 1)) {
+            break;
         }
-        assert(count < m_capacity);
-    } while (!m_count.compare_exchange_weak(count, count + 1));
+    }
 
     assert(m_count.load() < m_capacity);
     return true;
@@ -50,19 +53,66 @@ bool AsyncBarrier::arriveAndRelease(Coroutine* awaiter) noexcept
 {
     auto scopeTracker = m_asyncScope.onEnter();
 
-    if (m_count.load() != m_capacity - 1)
+    // claims the waiters, a timed out waiter can no longer withdraw its arrival
+    auto count = m_capacity - 1;
+    if (!m_count.compare_exchange_strong(count, 0))
         return false;
 
-    int dequeCount = !awaiter ? m_capacity - 1 : m_capacity;
-    m_count = 0;
-    for (int i = 0; i < dequeCount; i++) {
+    releaseWaiters(!awaiter ? m_capacity - 1 : m_capacity, awaiter);
+    return true;
+}
+
+// Dequeues count waiters, skipping awaiter which continues on its own. A
+// waiter being removed after a timeout is briefly off the list, so an empty
+// list is retried until the counted waiters show up.
+void AsyncBarrier::releaseWaiters(int count, Coroutine* awaiter) noexcept
+{
+    ScheduleBatch batch;
+    SpinWait spinWait;
+    for (int i = 0; i < count;) {
         auto* op = m_waitList.dequeue();
+        if (!op) {
+            spinWait.spinOne();
+            continue;
+        }
         assert(!op->next());
+        i++;
         if (awaiter && op == awaiter)
             continue;
-        op->schedule();
+        batch.add(op);
+    }
+    batch.schedule();
+}
+
+// Takes a timed out waiter off the wait list and withdraws its arrival.
+// Returns false if a release already claimed it, the release then resumes it.
+bool AsyncBarrier::remove(Coroutine* coroutineToRemove) noexcept
+{
+    auto scopeTracker = m_asyncScope.onEnter();
+
+    auto count = m_count.load();
+    do {
+        if (count == 0)
+            return false;
+    } while (!m_count.compare_exchange_weak(count, count - 1));
+
+    if (m_waitList.remove(coroutineToRemove))
+        return true;
+
+    // A release took it after all, so the withdrawn arrival belongs to a waiter
+    // still on the list. Giving it back may complete the barrier.
+    count = m_count.load();
+    while (true) {
+        if (count == m_capacity - 1) {
+            if (m_count.compare_exchange_weak(count, 0)) {
+                releaseWaiters(m_capacity, nullptr);
+                return false;
+            }
+            continue;
+        }
+        if (m_count.compare_exchange_weak(count, count + 1))
+            return false;
     }
-    return true;
 }
 
 bool AsyncBarrier::isWaitListEmpty() const noexcept
@@ -77,10 +127,12 @@ void AsyncBarrier::cancel() noexcept
     auto scopeTracker = m_asyncScope.onEnter();
 
     m_canceled = true;
+    ScheduleBatch batch;
     while (auto* coroutine = m_waitList.dequeue()) {
         coroutine->setCancelled();
-        coroutine->schedule();
+        batch.add(coroutine);
     }
+    batch.schedule();
 }
 
 bool AsyncBarrier::isCanceled() const noexcept
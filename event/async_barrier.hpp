@@ -83,8 +83,15 @@ struct AsyncBarrier {
         {
             auto& coroutine = Awaiter::coroutine();
             (void)coroutine;
-            assert(coroutine.isCancelled());
+            assert(coroutine.isCancelled() || isTimedOut());
             assert(coroutine.status() == CoroutineStatus::PauseOnRunning || coroutine.status() == CoroutineStatus::Paused);
+            // a timed out waiter leaves on its own, cancelling breaks the barrier for everyone
+            if (isTimedOut()) {
+                auto removed = m_barrier.remove(&coroutine);
+                if (removed)
+                    coroutine.schedule();
+                return removed;
+            }
             m_barrier.cancel();
             return true;
         }
@@ -98,6 +105,8 @@ struct AsyncBarrier {
 private:
     bool arriveAndWait(Coroutine* awaiter) noexcept;
     bool arriveAndRelease(Coroutine* awaiter) noexcept;
+    void releaseWaiters(int count, Coroutine* awaiter) noexcept;
+    bool remove(Coroutine* coroutineToRemove) noexcept;
 
     FifoWaitList m_waitList;
     std::atomic<int> m_count;
@@ -10,6 +10,7 @@
 #include "task/cancellation_error.hpp"
 #include "task/sync_task.hpp"
 #include "test/async_test_utils.hpp"
+#include "thread_pool.hpp"
 #include "async_barrier.hpp"
 
 namespace Levelz::Async::Test {
@@ -53,6 +54,42 @@ TEST_CASE("AsyncBarrier", "[AsyncBarrier]")
     REPEAT_FOOTER
 }
 
+TEST_CASE("AsyncBarrier - many waiters on several thread pools", "[AsyncBarrier]")
+{
+    constexpr int rounds = 3;
+    constexpr int workers = 500;
+    ThreadPool threadPool1 { ThreadPoolOptions { .name = "barrier-1", .threadCount = 3 } };
+    ThreadPool threadPool2 { ThreadPoolOptions {
+        .name = "barrier-2", .threadCount = 2, .kind = ThreadPoolKind::Background } };
+
+    std::atomic<int> arrived = 0;
+    std::atomic<bool> failed = false;
+    AsyncBarrier barrier { workers };
+
+    auto worker = [&](RunOn) -> Async<> {
+        for (int i = 0; i < rounds; i++) {
+            arrived++;
+            co_await barrier;
+            if (arrived < (i + 1) * workers)
+                failed = true;
+        }
+    };
+
+    auto run = [&]() -> SyncTask<> {
+        std::vector<Async<>> tasks;
+        tasks.reserve(workers);
+        for (int i = 0; i < workers; i++)
+            tasks.push_back(worker(i % 2 ? threadPool1 : threadPool2));
+
+        for (int i = 0; i < workers; i++)
+            co_await tasks[i];
+    };
+
+    run().get();
+    REQUIRE(arrived == rounds * workers);
+    REQUIRE(!failed);
+}
+
 TEST_CASE("AsyncBarrier - cancel", "[AsyncBarrier]")
 {
     constexpr int rounds = 5;
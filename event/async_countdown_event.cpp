@@ -3,6 +3,7 @@
 //
 
 #include "async_countdown_event.hpp"
+#include "schedule_batch.hpp"
 #include "task/simple_task.hpp"
 
 namespace Levelz::Async {
@@ -77,15 +78,16 @@ void AsyncCountDownEvent::resumeWaiting() noexcept
 {
     assert(m_count >= 0 && m_count <= m_maxCount);
 
+    ScheduleBatch batch;
     while (auto* coroutine = m_waitQueue.dequeue()) {
         assert(!coroutine->next());
-        if (!isZero())
+        if (!isZero()) {
             m_waitQueue.enqueue(coroutine);
-        else
-            coroutine->schedule();
-        if (!isZero())
             break;
+        }
+        batch.add(coroutine);
     }
+    batch.schedule();
 }
 
 bool AsyncCountDownEvent::enqueue(Coroutine& coroutine) noexcept
@@ -194,7 +196,7 @@ void AsyncCountDownEvent::AsyncCountDownEventAwaiter::await_resume()
 bool AsyncCountDownEvent::AsyncCountDownEventAwaiter::cancel() noexcept
 {
     auto& coroutine = Awaiter::coroutine();
-    assert(coroutine.isCancelled());
+    assert(coroutine.isCancelled() || isTimedOut());
     assert(coroutine.status() == CoroutineStatus::PauseOnRunning || coroutine.status() == CoroutineStatus::Paused);
     auto removed = m_event.remove(&coroutine);
     if (removed)
@@ -145,7 +145,7 @@ struct AsyncMutexAwaiter : Awaiter {
     bool cancel() noexcept
     {
         auto& coroutine = Awaiter::coroutine();
-        assert(coroutine.isCancelled());
+        assert(coroutine.isCancelled() || isTimedOut());
         assert(coroutine.status() == CoroutineStatus::PauseOnRunning || coroutine.status() == CoroutineStatus::Paused);
         auto removed = m_mutex.remove(&coroutine);
         if (removed)
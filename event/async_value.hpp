@@ -66,7 +66,7 @@ struct BaseAsyncValueAwaiter : Awaiter {
     bool cancel() noexcept
     {
         auto& coroutine = Awaiter::coroutine();
-        assert(coroutine.isCancelled());
+        assert(coroutine.isCancelled() || isTimedOut());
         assert(coroutine.status() == CoroutineStatus::PauseOnRunning || coroutine.status() == CoroutineStatus::Paused);
         auto removed = m_asyncValueEvent.remove(&coroutine);
         if (removed)
@@ -4,8 +4,8 @@
 
 #include <cassert>
 
-#include "task/simple_task.hpp"
 #include "sync_auto_reset_event.hpp"
+#include "work_item.hpp"
 
 namespace Levelz::Async {
 
@@ -26,21 +26,15 @@ void SyncAutoResetEvent::set() noexcept
     m_cv.notify_one();
 }
 
-BackgroundSimpleTask SyncAutoResetEvent::asyncSetTask()
-{
-    set();
-    co_return;
-}
-
 void SyncAutoResetEvent::asyncSet() noexcept
 {
     bool lockSuccess = trySet();
     if (lockSuccess)
         return;
 
-    BackgroundSimpleTask simpleTask = asyncSetTask();
-    simpleTask.coroutine().schedule();
-    simpleTask.clear();
+    // without memory for the work item set inline, blocking until the waiter drops the lock
+    if (!post(ThreadPool::backgroundThreadPool(), [this] { set(); }))
+        set();
 }
 
 void SyncAutoResetEvent::wait() noexcept
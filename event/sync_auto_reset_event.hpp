@@ -5,11 +5,12 @@
 #ifndef LEVELZ_SYNC_AUTO_RESET_EVENT_HPP
 #define LEVELZ_SYNC_AUTO_RESET_EVENT_HPP
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <mutex>
 
-#include "task/simple_task.hpp"
+#include "thread_pool_kind.hpp"
 
 namespace Levelz::Async {
 
@@ -32,8 +33,6 @@ private:
         None
     };
 
-    BackgroundSimpleTask asyncSetTask();
-
     std::mutex m_mutex;
     std::condition_variable m_cv;
     std::atomic<State> m_state;
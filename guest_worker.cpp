@@ -0,0 +1,23 @@
+#include "guest_worker.hpp"
+#include "thread_pool.hpp"
+
+namespace Levelz::Async {
+
+GuestWorker::GuestWorker(ThreadPool& threadPool)
+    : m_threadPool { threadPool }
+    , m_state {}
+{
+    m_threadPool.enterGuest(m_state);
+}
+
+GuestWorker::~GuestWorker()
+{
+    m_threadPool.leaveInline();
+}
+
+void GuestWorker::runUntil(const std::function<bool()>& isDone)
+{
+    m_threadPool.runInline(isDone);
+}
+
+}
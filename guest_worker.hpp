@@ -0,0 +1,38 @@
+#ifndef LEVELZ_GUEST_WORKER_HPP
+#define LEVELZ_GUEST_WORKER_HPP
+
+#include <functional>
+
+#include "thread_state.hpp"
+
+namespace Levelz::Async {
+
+struct ThreadPool;
+
+// Lets an external thread, an I/O thread say, help a thread pool while it
+// lives. Unlike an InlineWorker it takes one of the pool's guest slots, so
+// workers steal what it schedules and it steals from them. Only the coroutine
+// it is about to run next stays with it until runUntil returns. When every
+// slot is taken it runs as an inline worker.
+struct GuestWorker {
+    explicit GuestWorker(ThreadPool& threadPool);
+    ~GuestWorker();
+
+    GuestWorker(const GuestWorker&) = delete;
+    GuestWorker(GuestWorker&&) = delete;
+    GuestWorker& operator=(const GuestWorker&) = delete;
+    GuestWorker& operator=(GuestWorker&&) = delete;
+
+    // Runs coroutines until isDone returns true or no work turns up for as
+    // long as the pool's workers spin before parking, so the thread can go
+    // back to its own work once the pool runs dry
+    void runUntil(const std::function<bool()>& isDone);
+
+private:
+    ThreadPool& m_threadPool;
+    ThreadState m_state;
+};
+
+}
+
+#endif // LEVELZ_GUEST_WORKER_HPP
@@ -0,0 +1,17 @@
+#ifndef LEVELZ_IDLE_POLICY_HPP
+#define LEVELZ_IDLE_POLICY_HPP
+
+namespace Levelz::Async {
+
+enum class IdlePolicy {
+    // spin for about twice the pool's recent idle gaps, park right away when they are long
+    Adaptive,
+    // never park, for latency critical pools on dedicated cores
+    BusyPoll,
+    // park as soon as no work is found, for power sensitive batch pools
+    ParkImmediately
+};
+
+}
+
+#endif // LEVELZ_IDLE_POLICY_HPP
@@ -0,0 +1,23 @@
+#include "inline_worker.hpp"
+#include "thread_pool.hpp"
+
+namespace Levelz::Async {
+
+InlineWorker::InlineWorker(ThreadPool& threadPool)
+    : m_threadPool { threadPool }
+    , m_state {}
+{
+    m_threadPool.enterInline(m_state);
+}
+
+InlineWorker::~InlineWorker()
+{
+    m_threadPool.leaveInline();
+}
+
+void InlineWorker::runUntil(const std::function<bool()>& isDone)
+{
+    m_threadPool.runInline(isDone);
+}
+
+}
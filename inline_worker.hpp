@@ -0,0 +1,35 @@
+#ifndef LEVELZ_INLINE_WORKER_HPP
+#define LEVELZ_INLINE_WORKER_HPP
+
+#include <functional>
+
+#include "thread_state.hpp"
+
+namespace Levelz::Async {
+
+struct ThreadPool;
+
+// Makes the calling thread a worker of the thread pool while it lives. The
+// thread is not one of the pool's workers, so what it schedules locally stays
+// with it and is handed to the pool when the worker goes away.
+struct InlineWorker {
+    explicit InlineWorker(ThreadPool& threadPool);
+    ~InlineWorker();
+
+    InlineWorker(const InlineWorker&) = delete;
+    InlineWorker(InlineWorker&&) = delete;
+    InlineWorker& operator=(const InlineWorker&) = delete;
+    InlineWorker& operator=(InlineWorker&&) = delete;
+
+    // Runs coroutines until isDone returns true or no work turns up for as
+    // long as the pool's workers spin before parking
+    void runUntil(const std::function<bool()>& isDone);
+
+private:
+    ThreadPool& m_threadPool;
+    ThreadState m_state;
+};
+
+}
+
+#endif // LEVELZ_INLINE_WORKER_HPP
@@ -0,0 +1,15 @@
+#ifndef LEVELZ_PRIORITY_HPP
+#define LEVELZ_PRIORITY_HPP
+
+namespace Levelz::Async {
+
+// Values double as lane indices, lower runs first
+enum class Priority {
+    High,
+    Normal,
+    Low
+};
+
+}
+
+#endif // LEVELZ_PRIORITY_HPP
@@ -0,0 +1,17 @@
+#include "coroutine.hpp"
+#include "priority_scope.hpp"
+
+namespace Levelz::Async {
+
+PriorityScope::PriorityScope(Priority priority) noexcept
+    : m_previousPriority { Coroutine::currentPriority() }
+{
+    Coroutine::setCurrentPriority(priority);
+}
+
+PriorityScope::~PriorityScope()
+{
+    Coroutine::setCurrentPriority(m_previousPriority);
+}
+
+}
@@ -0,0 +1,26 @@
+#ifndef LEVELZ_PRIORITY_SCOPE_HPP
+#define LEVELZ_PRIORITY_SCOPE_HPP
+
+#include "priority.hpp"
+
+namespace Levelz::Async {
+
+// Sets the priority of the current coroutine, or of the current thread outside
+// coroutines, until the end of the scope. Coroutines inherit the priority of
+// whoever creates them.
+struct PriorityScope {
+    explicit PriorityScope(Priority priority) noexcept;
+    ~PriorityScope();
+
+    PriorityScope(const PriorityScope&) = delete;
+    PriorityScope(PriorityScope&&) = delete;
+    PriorityScope& operator=(const PriorityScope&) = delete;
+    PriorityScope& operator=(PriorityScope&&) = delete;
+
+private:
+    const Priority m_previousPriority;
+};
+
+}
+
+#endif // LEVELZ_PRIORITY_SCOPE_HPP
@@ -0,0 +1,107 @@
+#ifndef LEVELZ_RESUME_ON_AWAITER_HPP
+#define LEVELZ_RESUME_ON_AWAITER_HPP
+
+#include <coroutine>
+
+#include "awaiter.hpp"
+#include "coroutine.hpp"
+#include "thread_pool.hpp"
+
+namespace Levelz::Async {
+
+// co_await resumeOn(threadPool) continues the coroutine on threadPool, where
+// it stays until it moves again. A no-op when already running there.
+struct ResumeOn {
+    ThreadPool& threadPool;
+};
+
+inline ResumeOn resumeOn(ThreadPool& threadPool) noexcept
+{
+    return { threadPool };
+}
+
+// auto scope = co_await scopedResumeOn(threadPool) also moves the coroutine,
+// and when scope goes away the coroutine returns to its previous pool at its
+// next await point
+struct ScopedResumeOn {
+    ThreadPool& threadPool;
+};
+
+inline ScopedResumeOn scopedResumeOn(ThreadPool& threadPool) noexcept
+{
+    return { threadPool };
+}
+
+struct ResumeOnScope {
+    ResumeOnScope(Coroutine& coroutine, ThreadPool& previousThreadPool) noexcept
+        : m_coroutine { coroutine }
+        , m_previousThreadPool { previousThreadPool }
+    {
+    }
+
+    ~ResumeOnScope()
+    {
+        m_coroutine.setThreadPool(m_previousThreadPool);
+    }
+
+    ResumeOnScope(const ResumeOnScope&) = delete;
+    ResumeOnScope(ResumeOnScope&&) = delete;
+    ResumeOnScope& operator=(const ResumeOnScope&) = delete;
+    ResumeOnScope& operator=(ResumeOnScope&&) = delete;
+
+private:
+    Coroutine& m_coroutine;
+    ThreadPool& m_previousThreadPool;
+};
+
+struct ResumeOnAwaiter : Awaiter {
+    ResumeOnAwaiter(ThreadPool& threadPool, Coroutine& coroutine) noexcept
+        : Awaiter { coroutine, AwaiterKind::ThreadPool }
+        , m_threadPool { threadPool }
+        , m_previousThreadPool { coroutine.threadPool() }
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        // the awaiter schedules the coroutine on its pool, which now is the target
+        coroutine().setThreadPool(m_threadPool);
+        auto suspensionAdvice = Awaiter::onReady();
+        if (suspensionAdvice == Awaiter::SuspensionAdvice::shouldNotSuspend)
+            return true;
+        return suspensionAdvice == Awaiter::SuspensionAdvice::maySuspend;
+    }
+
+    bool await_suspend(std::coroutine_handle<> awaitingCoroutine) noexcept
+    {
+        auto suspensionAdvice = Awaiter::onSuspend(awaitingCoroutine);
+        if (suspensionAdvice == Awaiter::SuspensionAdvice::shouldNotSuspend)
+            return false;
+
+        coroutine().schedule();
+        return true;
+    }
+
+    void await_resume()
+    {
+        Awaiter::onResume();
+    }
+
+protected:
+    ThreadPool& m_threadPool;
+    ThreadPool& m_previousThreadPool;
+};
+
+struct ScopedResumeOnAwaiter : ResumeOnAwaiter {
+    using ResumeOnAwaiter::ResumeOnAwaiter;
+
+    [[nodiscard]] ResumeOnScope await_resume()
+    {
+        ResumeOnAwaiter::await_resume();
+        return { coroutine(), m_previousThreadPool };
+    }
+};
+
+}
+
+#endif // LEVELZ_RESUME_ON_AWAITER_HPP
@@ -0,0 +1,32 @@
+#ifndef LEVELZ_RUN_ON_HPP
+#define LEVELZ_RUN_ON_HPP
+
+namespace Levelz::Async {
+
+struct ThreadPool;
+
+// Coroutine parameter that picks the pool the coroutine runs on, for tasks
+// whose ThreadPoolKind is Current. The first RunOn parameter wins and kinds
+// naming a fixed pool ignore it. A plain ThreadPool& parameter is just an
+// argument, the coroutine still runs on its caller's pool.
+//
+//     auto work(RunOn threadPool, int value) -> Async<int>;
+//     co_await work(myThreadPool, 1);
+struct RunOn {
+    RunOn(ThreadPool& threadPool) noexcept
+        : m_threadPool { threadPool }
+    {
+    }
+
+    ThreadPool& threadPool() const noexcept
+    {
+        return m_threadPool;
+    }
+
+private:
+    ThreadPool& m_threadPool;
+};
+
+}
+
+#endif // LEVELZ_RUN_ON_HPP
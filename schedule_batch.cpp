@@ -0,0 +1,75 @@
+#include <cassert>
+
+#include "coroutine.hpp"
+#include "schedule_batch.hpp"
+#include "thread_pool.hpp"
+
+namespace Levelz::Async {
+
+ScheduleBatch::ScheduleBatch() noexcept
+    : m_chains {}
+    , m_chainCount { 0 }
+{
+}
+
+ScheduleBatch::~ScheduleBatch()
+{
+    schedule();
+}
+
+void ScheduleBatch::add(Coroutine* coroutine) noexcept
+{
+    assert(!coroutine->next());
+    auto* threadPool = &coroutine->threadPool();
+    auto priority = coroutine->priority();
+    auto hasDeadline = coroutine->hasDeadline();
+
+    Chain* chain = nullptr;
+    for (int i = 0; i < m_chainCount; ++i) {
+        if (m_chains[i].threadPool == threadPool && m_chains[i].priority == priority
+            && m_chains[i].hasDeadline == hasDeadline) {
+            chain = &m_chains[i];
+            break;
+        }
+    }
+
+    if (!chain) {
+        // more pools and priorities than chains is rare, flush the last one to make room
+        if (m_chainCount == s_maxChainCount)
+            schedule(m_chains[--m_chainCount]);
+        chain = &m_chains[m_chainCount++];
+        *chain = Chain {
+            .threadPool = threadPool,
+            .priority = priority,
+            .hasDeadline = hasDeadline,
+            .first = coroutine,
+            .last = coroutine,
+            .count = 1
+        };
+        return;
+    }
+
+    chain->last->setNext(coroutine);
+    chain->last = coroutine;
+    chain->count++;
+}
+
+void ScheduleBatch::schedule() noexcept
+{
+    for (int i = 0; i < m_chainCount; ++i)
+        schedule(m_chains[i]);
+    m_chainCount = 0;
+}
+
+bool ScheduleBatch::isEmpty() const noexcept
+{
+    return m_chainCount == 0;
+}
+
+void ScheduleBatch::schedule(Chain& chain) noexcept
+{
+    chain.threadPool->scheduleOnThreadPool(chain.first, chain.last, chain.count);
+    chain = Chain {};
+}
+
+}
@@ -0,0 +1,50 @@
+#ifndef LEVELZ_SCHEDULE_BATCH_HPP
+#define LEVELZ_SCHEDULE_BATCH_HPP
+
+#include <array>
+
+#include "priority.hpp"
+
+namespace Levelz::Async {
+
+struct Coroutine;
+struct ThreadPool;
+
+// Collects coroutines to be scheduled together. Each thread pool and priority
+// lane gets its part of the batch linked into its queue at once and wakes only as many workers
+// as the batch needs. Coroutines with a deadline are chained apart and go to
+// a deadline heap together.
+struct ScheduleBatch {
+    ScheduleBatch() noexcept;
+    ~ScheduleBatch();
+
+    ScheduleBatch(const ScheduleBatch&) = delete;
+    ScheduleBatch(ScheduleBatch&&) = delete;
+    ScheduleBatch& operator=(const ScheduleBatch&) = delete;
+    ScheduleBatch& operator=(ScheduleBatch&&) = delete;
+
+    void add(Coroutine* coroutine) noexcept;
+    void schedule() noexcept;
+    bool isEmpty() const noexcept;
+
+private:
+    struct Chain {
+        ThreadPool* threadPool;
+        Priority priority;
+        bool hasDeadline;
+        Coroutine* first;
+        Coroutine* last;
+        int count;
+    };
+
+    static void schedule(Chain& chain) noexcept;
+
+    static constexpr int s_maxChainCount = 6;
+
+    std::array<Chain, s_maxChainCount> m_chains;
+    int m_chainCount;
+};
+
+}
+
+#endif // LEVELZ_SCHEDULE_BATCH_HPP
@@ -24,8 +24,8 @@ template <typename ValueType, ThreadPoolKind TPK>
 struct AsyncTaskPromiseBase : BasePromise {
     using CanDestroyNotStarted = std::false_type;
 
-    explicit AsyncTaskPromiseBase(std::coroutine_handle<> handle) noexcept
-        : BasePromise { handle, TaskKind::Async, TPK }
+    explicit AsyncTaskPromiseBase(std::coroutine_handle<> handle, ThreadPool* threadPool = nullptr) noexcept
+        : BasePromise { handle, TaskKind::Async, TPK, threadPool }
     {
     }
 
@@ -100,9 +100,11 @@ template <typename ValueType, ThreadPoolKind TPK>
 struct AsyncTaskPromise : public AsyncTaskPromiseBase<ValueType, TPK> {
     using promise_type = AsyncTaskPromise<ValueType, TPK>;
 
-    AsyncTaskPromise() noexcept
+    template <typename... Args>
+    explicit AsyncTaskPromise(Args&... args) noexcept
         : AsyncTaskPromiseBase<ValueType, TPK> {
-            std::coroutine_handle<promise_type>::from_promise(*this)
+            std::coroutine_handle<promise_type>::from_promise(*this),
+            BasePromise::threadPoolArgument(args...)
         }
     {
     }
@@ -130,9 +132,11 @@ template <ThreadPoolKind TPK>
 struct AsyncTaskPromise<void, TPK> : public AsyncTaskPromiseBase<void, TPK> {
     using promise_type = AsyncTaskPromise<void, TPK>;
 
-    AsyncTaskPromise() noexcept
+    template <typename... Args>
+    explicit AsyncTaskPromise(Args&... args) noexcept
         : AsyncTaskPromiseBase<void, TPK> {
-            std::coroutine_handle<AsyncTaskPromise<void, TPK>>::from_promise(*this)
+            std::coroutine_handle<AsyncTaskPromise<void, TPK>>::from_promise(*this),
+            BasePromise::threadPoolArgument(args...)
         }
     {
     }
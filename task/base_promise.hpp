@@ -6,16 +6,24 @@
 #define LEVELZ_BASE_PROMISE_HPP
 
 #include <coroutine>
+#include <type_traits>
 
+#include "blocking_awaiter.hpp"
 #include "coroutine.hpp"
 #include "event/async_barrier.hpp"
 #include "event/async_countdown_event.hpp"
 #include "event/async_event.hpp"
 #include "event/async_mutex.hpp"
 #include "event/async_value.hpp"
+#include "resume_on_awaiter.hpp"
+#include "run_on.hpp"
 #include "task_kind.hpp"
 #include "simple_task.hpp"
 #include "task_awaiter.hpp"
+#include "timer/periodic_timer.hpp"
+#include "timer/sleep.hpp"
+#include "timer/timeout.hpp"
+#include "yield_awaiter.hpp"
 
 namespace Levelz::Async {
 
@@ -29,8 +37,9 @@ struct BasePromise {
     template <typename ValueType>
     using AsyncTaskAwaiterType = AsyncValue<ValueType>::AwaiterType;
 
-    BasePromise(std::coroutine_handle<> handle, TaskKind taskKind, ThreadPoolKind threadPoolKind) noexcept
-        : m_coroutine { handle, true, taskKind, threadPoolKind }
+    BasePromise(std::coroutine_handle<> handle, TaskKind taskKind, ThreadPoolKind threadPoolKind,
+        ThreadPool* threadPool = nullptr) noexcept
+        : m_coroutine { handle, true, taskKind, threadPoolKind, threadPool }
     {
     }
 
@@ -89,6 +98,63 @@ struct BasePromise {
         return AsyncCountDownEvent::AsyncCountDownEventAwaiter { event, m_coroutine };
     }
 
+    SleepAwaiter await_transform(Sleep sleep)
+    {
+        if (m_coroutine.isCancelled())
+            throw CancellationError {};
+
+        return { sleep.deadline, m_coroutine };
+    }
+
+    SleepAwaiter await_transform(PeriodicTimer& periodicTimer)
+    {
+        if (m_coroutine.isCancelled())
+            throw CancellationError {};
+
+        return { periodicTimer.nextDeadline(), m_coroutine };
+    }
+
+    YieldAwaiter await_transform(Yield)
+    {
+        if (m_coroutine.isCancelled())
+            throw CancellationError {};
+
+        return YieldAwaiter { m_coroutine };
+    }
+
+    ResumeOnAwaiter await_transform(ResumeOn resumeOn)
+    {
+        if (m_coroutine.isCancelled())
+            throw CancellationError {};
+
+        return { resumeOn.threadPool, m_coroutine };
+    }
+
+    ScopedResumeOnAwaiter await_transform(ScopedResumeOn resumeOn)
+    {
+        if (m_coroutine.isCancelled())
+            throw CancellationError {};
+
+        return { resumeOn.threadPool, m_coroutine };
+    }
+
+    template <typename Function>
+    BlockingAwaiter<Function> await_transform(Blocking<Function> blocking)
+    {
+        if (m_coroutine.isCancelled())
+            throw CancellationError {};
+
+        return { std::move(blocking.function), m_coroutine };
+    }
+
+    template <typename Awaitable>
+    auto await_transform(Timeout<Awaitable> timeout)
+    {
+        using AwaiterType = decltype(await_transform(std::declval<Awaitable>()));
+        auto makeAwaiter = [&]() { return await_transform(std::forward<Awaitable>(timeout.awaitable)); };
+        return TimeoutAwaiter<AwaiterType> { makeAwaiter, timeout.deadline };
+    }
+
     template <typename T>
     typename AsyncValue<T>::AwaiterType await_transform(AsyncValue<T>& asyncValue)
     {
@@ -179,6 +245,16 @@ struct BasePromise {
         return m_refCount;
     }
 
+    // A coroutine taking a RunOn parameter runs on its pool unless its
+    // ThreadPoolKind names a fixed pool, see RunOn.
+    template <typename... Args>
+    static ThreadPool* threadPoolArgument(Args&... args) noexcept
+    {
+        ThreadPool* threadPool = nullptr;
+        ((threadPool = threadPool ? threadPool : asThreadPool(args)), ...);
+        return threadPool;
+    }
+
     static SimpleTask<> asyncSetCompletedState(Coroutine& coroutine) noexcept
     {
         auto handle = coroutine.handle();
@@ -200,6 +276,15 @@ struct BasePromise {
     }
 
 private:
+    template <typename T>
+    static ThreadPool* asThreadPool(T& argument) noexcept
+    {
+        if constexpr (std::is_same_v<std::remove_cv_t<T>, RunOn>)
+            return &argument.threadPool();
+        else
+            return nullptr;
+    }
+
     Coroutine m_coroutine;
     std::atomic<uint64_t> m_refCount;
 };
@@ -0,0 +1,28 @@
+#ifndef LEVELZ_BLOCK_ON_HPP
+#define LEVELZ_BLOCK_ON_HPP
+
+#include "guest_worker.hpp"
+#include "thread_pool.hpp"
+
+namespace Levelz::Async {
+
+// Calls makeTask, which returns a Sync task, and runs the task and the
+// coroutines it schedules on the calling thread, which joins the pool as a
+// GuestWorker so the pool's workers steal what the task fans out. The task
+// does not hop to a pool worker and back.
+//
+// Once no work turns up for as long as the pool's workers spin before
+// parking, the calling thread stops helping and blocks in task.get(). From
+// then on the task resumes on pool workers like any Sync task.
+template <typename MakeTask>
+decltype(auto) blockOn(MakeTask&& makeTask, ThreadPool& threadPool = ThreadPool::defaultThreadPool())
+{
+    GuestWorker worker { threadPool };
+    auto task = makeTask();
+    worker.runUntil([&task] { return task.isReady(); });
+    return task.get();
+}
+
+}
+
+#endif // LEVELZ_BLOCK_ON_HPP
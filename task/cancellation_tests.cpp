@@ -5,6 +5,7 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "async_spin_wait.hpp"
+#include "deadline_scope.hpp"
 #include "event/async_barrier.hpp"
 #include "event/async_event.hpp"
 #include "event/async_mutex.hpp"
@@ -211,7 +212,7 @@ TEST_CASE("Cancel - Mutex", "[AsyncTask]")
 
             auto task1 = coroutine(true, false);
             AsyncSpinWait spinWait;
-            while (!mutex.isLocked()) {
+            while (value1 == 0) {
                 spinWait.spinOne();
             }
 
@@ -900,4 +901,98 @@ TEST_CASE("Task - immediately cancel async blocked on task", "[Task]")
     REPEAT_FOOTER
 }
 
+TEST_CASE("Cancel - deadline is inherited", "[AsyncTask]")
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::hours { 1 };
+
+    auto child = []() -> Task<std::chrono::steady_clock::time_point> {
+        co_return Coroutine::currentCoroutine()->deadline();
+    };
+
+    auto runner = [&]() -> SyncTask<bool> {
+        bool inherited = co_await child() == std::chrono::steady_clock::time_point::max();
+        {
+            DeadlineScope deadlineScope { deadline };
+            inherited = inherited && co_await child() == deadline;
+            {
+                // a looser deadline does not extend the outer one
+                DeadlineScope looserScope { deadline + std::chrono::hours { 1 } };
+                inherited = inherited && co_await child() == deadline;
+            }
+        }
+        co_return inherited && !Coroutine::currentCoroutine()->hasDeadline();
+    };
+    REQUIRE(runner().get());
+}
+
+TEST_CASE("Cancel - task past deadline", "[AsyncTask]")
+{
+    std::atomic<int> value = 0;
+
+    auto child = [&]() -> Task<> {
+        value++;
+        co_return;
+    };
+
+    auto slow = [&]() -> Async<> {
+        std::this_thread::sleep_for(std::chrono::milliseconds { 5 });
+        co_await child();
+        value++;
+    };
+
+    auto runner = [&]() -> SyncTask<> {
+        Async<> task;
+        {
+            DeadlineScope deadlineScope { std::chrono::milliseconds { 1 } };
+            task = slow();
+        }
+        REQUIRE_THROWS_AS(co_await task, CancellationError);
+        REQUIRE(value == 0);
+    };
+    runner().get();
+}
+
+TEST_CASE("Cancel - coroutine blocked past its deadline", "[AsyncTask]")
+{
+    AsyncEvent event;
+    AsyncMutex mutex;
+    AsyncEvent locked;
+    AsyncEvent release;
+
+    auto holder = [&]() -> Async<> {
+        auto lock = co_await mutex;
+        locked.signal();
+        co_await release;
+    };
+
+    auto eventWaiter = [&]() -> Async<> {
+        co_await event;
+    };
+
+    auto mutexWaiter = [&]() -> Async<> {
+        auto lock = co_await mutex;
+        (void)lock;
+    };
+
+    auto runner = [&]() -> SyncTask<> {
+        auto task = holder();
+        co_await locked;
+        Async<> eventTask;
+        Async<> mutexTask;
+        {
+            DeadlineScope deadlineScope { std::chrono::milliseconds { 10 } };
+            eventTask = eventWaiter();
+            mutexTask = mutexWaiter();
+        }
+        // nothing wakes them, the deadline timer cancels both
+        REQUIRE_THROWS_AS(co_await eventTask, CancellationError);
+        REQUIRE_THROWS_AS(co_await mutexTask, CancellationError);
+        REQUIRE(event.isWaitListEmpty());
+        REQUIRE(mutex.isWaitListEmpty());
+        release.signal();
+        co_await task;
+    };
+    runner().get();
+}
+
 }
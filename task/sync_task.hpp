@@ -40,6 +40,12 @@ struct [[nodiscard]] SyncTask : BaseTask<SyncTaskPromise<ValueType, TPK>> {
         return BaseTask<promise_type>::m_handle.promise().value();
     }
 
+    // true once get() no longer blocks
+    [[nodiscard]] bool isReady() const noexcept
+    {
+        return BaseTask<promise_type>::m_handle.promise().isReady();
+    }
+
 private:
     template <typename, ThreadPoolKind>
     friend struct SyncTaskPromise;
@@ -79,6 +85,11 @@ struct [[nodiscard]] SyncTask<ValueType&&, TPK> : BaseTask<SyncTaskPromise<Value
         return std::move(BaseTask<promise_type>::m_handle.promise().value());
     }
 
+    [[nodiscard]] bool isReady() const noexcept
+    {
+        return BaseTask<promise_type>::m_handle.promise().isReady();
+    }
+
 private:
     template <typename, ThreadPoolKind>
     friend struct SyncTaskPromise;
@@ -23,8 +23,8 @@ template <typename ValueType, ThreadPoolKind TPK>
 struct SyncTaskPromiseBase : BasePromise {
     using CanDestroyNotStarted = std::false_type;
 
-    explicit SyncTaskPromiseBase(std::coroutine_handle<> handle) noexcept
-        : BasePromise { handle, TaskKind::Sync, TPK }
+    explicit SyncTaskPromiseBase(std::coroutine_handle<> handle, ThreadPool* threadPool = nullptr) noexcept
+        : BasePromise { handle, TaskKind::Sync, TPK, threadPool }
         , m_value {}
         , m_event {}
     {
@@ -94,6 +94,11 @@ struct SyncTaskPromiseBase : BasePromise {
         m_value = std::current_exception();
     }
 
+    bool isReady() const noexcept
+    {
+        return m_event.isSet();
+    }
+
     void checkResult() const
     {
         assert(isDone());
@@ -133,9 +138,11 @@ template <typename ValueType, ThreadPoolKind TPK>
 struct SyncTaskPromise : SyncTaskPromiseBase<ValueType, TPK> {
     using promise_type = SyncTaskPromise<ValueType, TPK>;
 
-    SyncTaskPromise() noexcept
+    template <typename... Args>
+    explicit SyncTaskPromise(Args&... args) noexcept
         : SyncTaskPromiseBase<ValueType, TPK> {
-            std::coroutine_handle<promise_type>::from_promise(*this)
+            std::coroutine_handle<promise_type>::from_promise(*this),
+            BasePromise::threadPoolArgument(args...)
         }
     {
     }
@@ -170,9 +177,11 @@ template <ThreadPoolKind TPK>
 struct SyncTaskPromise<void, TPK> : public SyncTaskPromiseBase<void, TPK> {
     using promise_type = SyncTaskPromise<void, TPK>;
 
-    SyncTaskPromise() noexcept
+    template <typename... Args>
+    explicit SyncTaskPromise(Args&... args) noexcept
         : SyncTaskPromiseBase<void, TPK> {
-            std::coroutine_handle<promise_type>::from_promise(*this)
+            std::coroutine_handle<promise_type>::from_promise(*this),
+            BasePromise::threadPoolArgument(args...)
         }
     {
     }
@@ -205,9 +214,11 @@ template <typename ValueType, ThreadPoolKind TPK>
 struct SyncTaskPromise<ValueType&, TPK> : SyncTaskPromiseBase<ValueType*, TPK> {
     using promise_type = SyncTaskPromise<ValueType&, TPK>;
 
-    SyncTaskPromise() noexcept
+    template <typename... Args>
+    explicit SyncTaskPromise(Args&... args) noexcept
         : SyncTaskPromiseBase<ValueType*, TPK> {
-            std::coroutine_handle<promise_type>::from_promise(*this)
+            std::coroutine_handle<promise_type>::from_promise(*this),
+            BasePromise::threadPoolArgument(args...)
         }
     {
     }
@@ -241,9 +252,11 @@ template <typename ValueType, ThreadPoolKind TPK>
 struct SyncTaskPromise<ValueType&&, TPK> : SyncTaskPromiseBase<ValueType, TPK> {
     using promise_type = SyncTaskPromise<ValueType&&, TPK>;
 
-    SyncTaskPromise() noexcept
+    template <typename... Args>
+    explicit SyncTaskPromise(Args&... args) noexcept
         : SyncTaskPromiseBase<ValueType, TPK> {
-            std::coroutine_handle<promise_type>::from_promise(*this)
+            std::coroutine_handle<promise_type>::from_promise(*this),
+            BasePromise::threadPoolArgument(args...)
         }
     {
     }
@@ -60,7 +60,7 @@ struct TaskAwaiterBase : Awaiter {
             return std::noop_coroutine();
         }
 
-        if (m_taskCoroutine.threadPoolKind() != ThreadPool::currentThreadPoolKind()) {
+        if (&m_taskCoroutine.threadPool() != ThreadPool::currentThreadPool()) {
             m_taskCoroutine.schedule();
             return std::noop_coroutine();
         }
@@ -72,7 +72,7 @@ struct TaskAwaiterBase : Awaiter {
     {
         auto& coroutine = Awaiter::coroutine();
         (void)coroutine;
-        assert(coroutine.isCancelled());
+        assert(coroutine.isCancelled() || isTimedOut());
         assert(coroutine.status() == CoroutineStatus::PauseOnRunning || coroutine.status() == CoroutineStatus::Paused);
         auto continuationCoroutine = m_continuation.exchange(nullptr);
 
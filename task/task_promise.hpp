@@ -59,7 +59,7 @@ struct TaskPromiseYieldSuspendAwaiter : Awaiter {
             return std::noop_coroutine();
         }
 
-        if (continuation->threadPoolKind() != ThreadPool::currentThreadPoolKind()) {
+        if (&continuation->threadPool() != ThreadPool::currentThreadPool()) {
             continuation->schedule();
             return std::noop_coroutine();
         }
@@ -118,7 +118,7 @@ struct TaskPromiseFinalSuspendAwaiter : Awaiter {
             return std::noop_coroutine();
         }
 
-        if (continuation->threadPoolKind() != ThreadPool::currentThreadPoolKind()) {
+        if (&continuation->threadPool() != ThreadPool::currentThreadPool()) {
             continuation->schedule();
             return std::noop_coroutine();
         }
@@ -138,8 +138,8 @@ template <typename ValueType, ThreadPoolKind TPK>
 struct TaskPromiseBase : BasePromise {
     using CanDestroyNotStarted = std::true_type;
 
-    explicit TaskPromiseBase(std::coroutine_handle<> handle) noexcept
-        : BasePromise { handle, TaskKind::Task, TPK }
+    explicit TaskPromiseBase(std::coroutine_handle<> handle, ThreadPool* threadPool = nullptr) noexcept
+        : BasePromise { handle, TaskKind::Task, TPK, threadPool }
         , m_continuation { nullptr }
         , m_value {}
     {
@@ -228,8 +228,10 @@ template <typename ValueType, ThreadPoolKind TPK>
 struct TaskPromise : TaskPromiseBase<ValueType, TPK> {
     using promise_type = TaskPromise<ValueType, TPK>;
 
-    TaskPromise() noexcept
-        : TaskPromiseBase<ValueType, TPK>(std::coroutine_handle<promise_type>::from_promise(*this))
+    template <typename... Args>
+    explicit TaskPromise(Args&... args) noexcept
+        : TaskPromiseBase<ValueType, TPK>(std::coroutine_handle<promise_type>::from_promise(*this),
+            BasePromise::threadPoolArgument(args...))
     {
     }
 
@@ -272,8 +274,10 @@ template <ThreadPoolKind TPK>
 struct TaskPromise<void, TPK> : TaskPromiseBase<void, TPK> {
     using promise_type = TaskPromise<void, TPK>;
 
-    TaskPromise() noexcept
-        : TaskPromiseBase<void, TPK>(std::coroutine_handle<promise_type>::from_promise(*this))
+    template <typename... Args>
+    explicit TaskPromise(Args&... args) noexcept
+        : TaskPromiseBase<void, TPK>(std::coroutine_handle<promise_type>::from_promise(*this),
+            BasePromise::threadPoolArgument(args...))
     {
     }
 
@@ -304,8 +308,10 @@ template <typename ValueType, ThreadPoolKind TPK>
 struct TaskPromise<ValueType&, TPK> : TaskPromiseBase<ValueType*, TPK> {
     using promise_type = TaskPromise<ValueType&, TPK>;
 
-    TaskPromise() noexcept
-        : TaskPromiseBase<ValueType*, TPK>(std::coroutine_handle<promise_type>::from_promise(*this))
+    template <typename... Args>
+    explicit TaskPromise(Args&... args) noexcept
+        : TaskPromiseBase<ValueType*, TPK>(std::coroutine_handle<promise_type>::from_promise(*this),
+            BasePromise::threadPoolArgument(args...))
     {
     }
 
@@ -348,8 +354,10 @@ template <typename ValueType, ThreadPoolKind TPK>
 struct TaskPromise<ValueType&&, TPK> : TaskPromiseBase<ValueType, TPK> {
     using promise_type = TaskPromise<ValueType&&, TPK>;
 
-    TaskPromise() noexcept
-        : TaskPromiseBase<ValueType, TPK>(std::coroutine_handle<promise_type>::from_promise(*this))
+    template <typename... Args>
+    explicit TaskPromise(Args&... args) noexcept
+        : TaskPromiseBase<ValueType, TPK>(std::coroutine_handle<promise_type>::from_promise(*this),
+            BasePromise::threadPoolArgument(args...))
     {
     }
 
@@ -11,7 +11,8 @@ enum class TaskKind {
     Simple,
     Task,
     Async,
-    Sync
+    Sync,
+    WorkItem
 };
 
 }
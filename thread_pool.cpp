@@ -2,11 +2,17 @@
 // Created by irantha on 5/3/23.
 //
 
+#include <algorithm>
+#include <bit>
+#include <cerrno>
 #include <cstdio>
+#include <pthread.h>
 #include <stdexcept>
+#include <system_error>
 #include <thread>
 
 #include "coroutine.hpp"
+#include "cpu_topology.hpp"
 #include "spin_wait.hpp"
 #include "task/cancellation_error.hpp"
 #include "thread_pool.hpp"
@@ -15,48 +21,82 @@
 namespace Levelz::Async {
 
 namespace {
-    constexpr int s_maxThreadCount = 10;
     constexpr int s_backgroundThreadCount = 5;
-
-    ThreadPool& defaultThreadPool()
-    {
-        static ThreadPool s_threadPool { std::min(s_maxThreadCount, static_cast<int>(std::thread::hardware_concurrency())),
-            ThreadPoolKind::Default };
-        return s_threadPool;
-    }
-
-    ThreadPool& backgroundThreadPool()
-    {
-        static ThreadPool s_threadPool { std::min(s_backgroundThreadCount, s_maxThreadCount),
-            ThreadPoolKind::Background };
-        return s_threadPool;
-    }
 }
 
 thread_local ThreadState* ThreadPool::s_currentState = nullptr;
 thread_local ThreadPool* ThreadPool::s_currentThreadPool = nullptr;
 thread_local Coroutine* ThreadPool::s_currentCoroutine = nullptr;
+std::atomic<uint32_t> ThreadPool::s_nextSubmitterIndex = 0;
+thread_local uint32_t ThreadPool::s_submitterIndex = ThreadPool::s_nextSubmitterIndex++;
+thread_local int ThreadPool::s_resumeDepth = 0;
+thread_local Coroutine* ThreadPool::s_resumedCoroutine = nullptr;
+thread_local std::chrono::steady_clock::time_point ThreadPool::s_resumeStart {};
 
 ThreadPool::ThreadPool(int threadCount, ThreadPoolKind kind)
-    : m_threads {}
-    , m_threadCount { threadCount > 0 ? std::min(s_maxThreadCount, threadCount) : 1 }
-    , m_threadStates { std::make_unique<ThreadState[]>(m_threadCount) }
-    , m_globalQueue {}
+    : ThreadPool { ThreadPoolOptions { .threadCount = threadCount, .kind = kind } }
+{
+}
+
+ThreadPool::ThreadPool(const ThreadPoolOptions& options)
+    : m_state { State::NotStarted }
+    , m_threadCount { std::max({ options.threadCount, options.maxThreadCount, 1 }) }
+    , m_activeThreadCount { std::max(options.threadCount, 1) }
+    , m_guestThreadCount { std::max(options.guestThreadCount, 0) }
+    , m_guestSlots { std::make_unique<std::atomic<bool>[]>(m_guestThreadCount) }
+    , m_threadStates { std::make_unique<ThreadState[]>(m_threadCount + m_guestThreadCount) }
+    , m_stealableWordCount { (m_threadCount + m_guestThreadCount + 63) / 64 }
+    , m_stealableThreads { std::make_unique<std::atomic<uint64_t>[]>(m_stealableWordCount) }
+    , m_threads {}
+    , m_spareMutex {}
+    , m_spareCv {}
+    , m_pendingSlots {}
+    , m_retiredThreadIds {}
+    , m_idleSpareCount { 0 }
+    , m_maxSpareThreadCount { std::max(options.maxSpareThreadCount, 0) }
+    , m_startedThreadCount { 0 }
+    , m_lazyStart { options.lazyStart }
+    , m_stackSize { options.stackSize }
+    , m_minThreadCount { std::max(options.minThreadCount, 1) }
+    , m_controllerThread {}
+    , m_controllerCv {}
+    , m_lastResumeCount { 0 }
+    , m_lastThroughput { 0 }
+    , m_scaleStep { 0 }
     , m_mayBeSleepingThreadCount { 0 }
     , m_sleepingThreadCount { 0 }
-    , m_noLocalWork { kind == ThreadPoolKind::Background }
-    , m_state { State::NotStarted }
-    , m_kind { kind }
-    , m_pendingWakeUpRequestCount { 0 }
+    , m_searchingThreadCount { 0 }
+    , m_globalShardCount { m_threadCount }
+    , m_globalShards { std::make_unique<GlobalShard[]>(m_globalShardCount) }
+    , m_deadlineQueue {}
+    , m_noLocalWork { options.kind == ThreadPoolKind::Background }
+    , m_kind { options.kind }
+    , m_name { options.name }
+    , m_cpuSet { options.cpuSet }
+    , m_idlePolicy { options.idlePolicy }
+    , m_timeSlice { options.timeSlice }
+    , m_migrationPool { options.migrationPool != this ? options.migrationPool : nullptr }
+    , m_migrationThreshold { options.migrationThreshold }
+    , m_averageIdleGap { s_minSpinDuration.count() }
 {
-    assert(kind == ThreadPoolKind::Default || kind == ThreadPoolKind::Background);
+    assert(m_kind == ThreadPoolKind::Default || m_kind == ThreadPoolKind::Background);
 
-    m_threads.reserve(threadCount);
-    for (int i = 0; i < m_threadCount; ++i) {
+    for (int i = 0; i < m_threadCount + m_guestThreadCount; ++i)
         m_threadStates[i].setThreadIndex(i);
-        m_threads.emplace_back([this, i] { runWorkerThread(i); });
+    if (options.pinWorkers)
+        placeWorkers(options.cpuSet);
+
+    // each slot is pending at most once, so handing off never allocates
+    m_pendingSlots.reserve(m_threadCount);
+    if (!m_lazyStart) {
+        std::unique_lock lock { m_spareMutex };
+        // slots left without a thread are started on demand
+        if (!startThreads(m_activeThreadCount) && m_startedThreadCount == 0)
+            throw std::system_error { EAGAIN, std::generic_category(), "ThreadPool: no worker thread could be started" };
     }
     m_state = State::Started;
+    if (options.autoScale)
+        m_controllerThread = std::thread { [this] { runController(); } };
 }
 
 ThreadPool::~ThreadPool()
@@ -68,7 +108,9 @@ ThreadPool::~ThreadPool()
 Coroutine* ThreadPool::tryGetRemote() noexcept
 {
     assert(s_currentState);
-    auto* coroutine = tryGlobalDequeue();
+    auto* coroutine = tryDeadlineDequeue();
+    if (!coroutine)
+        coroutine = tryGlobalDequeue();
     if (!m_noLocalWork && !coroutine)
         coroutine = tryStealFromOtherThread();
     return coroutine;
@@ -78,14 +120,27 @@ Coroutine* ThreadPool::tryGetWork() noexcept
 {
     assert(s_currentState);
     Coroutine* coroutine = nullptr;
-    bool tryRemote = m_noLocalWork || s_currentState->rand() % 128 == 0;
+    s_currentState->advanceLaneOrder();
+    // deadline work competes with the high lane, including its anti-starvation turns
+    if (s_currentState->laneOrder()[0] == Priority::High)
+        coroutine = tryDeadlineDequeue();
+    if (coroutine)
+        return coroutine;
+
+    // a coroutine that ran out of its time slice yields to remote work first
+    bool tryRemote = s_currentState->takeTurnOver() || m_noLocalWork || s_currentState->rand() % 128 == 0;
     if (tryRemote)
         coroutine = tryGetRemote();
 
-    if (!coroutine)
+    if (!coroutine) {
         coroutine = s_currentState->tryLocalPop();
+        if (!coroutine)
+            setStealable(false);
+    }
     if (!coroutine && !tryRemote)
         coroutine = tryGetRemote();
+    if (!coroutine)
+        coroutine = s_currentState->tryTakeYielded();
 
     return coroutine;
 }
@@ -96,6 +151,8 @@ void ThreadPool::runWorkerThread(int threadIndex) noexcept
     s_currentState = &localState;
     s_currentThreadPool = this;
     assert(threadIndex == s_currentState->threadIndex());
+    setCurrentThreadName(threadIndex);
+    setCurrentThreadAffinity(threadIndex);
 
     while (true) {
         Coroutine* coroutine;
@@ -103,17 +160,31 @@ void ThreadPool::runWorkerThread(int threadIndex) noexcept
         while (true) {
             if (s_currentThreadPool->m_state == State::ShuttingDownImmediately)
                 return;
+            if (!isActive(threadIndex))
+                break;
 
             coroutine = tryGetWork();
             if (!coroutine)
                 break;
-            processPendingWakeUps();
             resume(coroutine, ThreadState::s_maxChainedExecutionAllowance);
+            if (!s_currentState)
+                return;
+        }
+
+        if (!isActive(threadIndex)) {
+            parkWorker(localState);
+            if (m_state == State::ShuttingDown || m_state == State::ShuttingDownImmediately)
+                return;
+            continue;
         }
 
+        startSearching();
+        auto idleStart = std::chrono::steady_clock::now();
+        auto spinStart = idleStart;
+        auto spinDuration = this->spinDuration();
         SpinWait spinWait;
         while (true) {
-            for (int i = 0; i < s_numRemoteWorksChecksBeforeSleep; ++i) {
+            while (true) {
                 coroutine = tryGetRemote();
 
                 if (coroutine)
@@ -123,37 +194,377 @@ void ThreadPool::runWorkerThread(int threadIndex) noexcept
                     || s_currentThreadPool->m_state == State::ShuttingDownImmediately)
                     return;
 
+                if (m_idlePolicy != IdlePolicy::BusyPoll
+                    && std::chrono::steady_clock::now() - spinStart >= spinDuration)
+                    break;
+
                 spinWait.spinOne();
             }
 
-            coroutine = tryGetRemote();
-            if (coroutine)
-                goto normal_processing;
-            if (m_pendingWakeUpRequestCount != 0)
-                goto normal_processing;
-
             if (!localState.isSleeping()) {
                 setSleeping(true);
                 continue;
-            } else {
-                assert(m_sleepingThreadCount < m_threadCount);
-                m_sleepingThreadCount++;
-                localState.sleepUntilWoken();
-                m_sleepingThreadCount--;
-                assert(m_sleepingThreadCount < m_threadCount);
-                setSleeping(false);
             }
+
+            // wakers skip waking anyone while this thread is searching, look
+            // once more after leaving the searching threads
+            (void)stopSearching();
+            coroutine = tryGetRemote();
+            if (coroutine)
+                goto normal_processing;
+
+            assert(m_sleepingThreadCount < m_threadCount);
+            m_sleepingThreadCount++;
+            auto token = localState.sleepUntilWoken();
+            m_sleepingThreadCount--;
+            assert(m_sleepingThreadCount < m_threadCount);
+            setSleeping(false);
+            if (token == ThreadState::WakeUpToken::Search)
+                localState.setSearching(true);
+            else
+                startSearching();
+            // woken to park, the worker loop parks it
+            if (!isActive(threadIndex))
+                goto normal_processing;
+            spinStart = std::chrono::steady_clock::now();
         }
 
     normal_processing:
-        if (localState.isSleeping())
+        if (m_idlePolicy == IdlePolicy::Adaptive)
+            recordIdleGap(std::chrono::steady_clock::now() - idleStart);
+
+        if (localState.isSleeping()) {
             setSleeping(false);
-        else
-            processPendingWakeUps();
+            // woken after it stopped searching but found work before sleeping
+            if (localState.takeWakeUpToken() == ThreadState::WakeUpToken::Search)
+                localState.setSearching(true);
+        }
 
-        if (coroutine)
+        // the last searcher to find work wakes a replacement if there is more work
+        if (localState.isSearching() && stopSearching()
+            && (localState.haveLocalWork() || haveGlobalWork()))
+            wakeOneThread();
+
+        if (coroutine) {
             resume(coroutine, ThreadState::s_maxChainedExecutionAllowance);
+            if (!s_currentState)
+                return;
+        }
+    }
+}
+
+bool ThreadPool::isActive(int threadIndex) const noexcept
+{
+    return threadIndex < m_activeThreadCount;
+}
+
+// Hands a parked worker's local work to the active workers and waits until
+// the pool grows back over its slot or shuts down
+void ThreadPool::parkWorker(ThreadState& state) noexcept
+{
+    int count = 0;
+    while (auto* coroutine = state.tryLocalPop()) {
+        globalEnqueue(coroutine);
+        count++;
+    }
+    while (auto* coroutine = state.tryTakeYielded()) {
+        globalEnqueue(coroutine);
+        count++;
+    }
+    while (auto* coroutine = state.tryDeadlinePop()) {
+        m_deadlineQueue.enqueue(coroutine);
+        count++;
+    }
+    setStealable(false);
+    if (count > 0)
+        wakeThreads(count);
+
+    // wakers only look at active slots, a parked worker does not count as sleeping
+    state.setSleeping(true);
+    while (!isActive(state.threadIndex()) && m_state != State::ShuttingDown
+        && m_state != State::ShuttingDownImmediately) {
+        // a waker that saw the slot still active passes its searching slot on
+        if (state.sleepUntilWoken() == ThreadState::WakeUpToken::Search) {
+            m_searchingThreadCount--;
+            wakeOneThread();
+        }
+    }
+    state.setSleeping(false);
+    if (state.takeWakeUpToken() == ThreadState::WakeUpToken::Search) {
+        m_searchingThreadCount--;
+        wakeOneThread();
+    }
+}
+
+void ThreadPool::resize(int threadCount)
+{
+    std::unique_lock lock { m_spareMutex };
+    if (m_state != State::Started)
+        return;
+
+    threadCount = std::clamp(threadCount, 1, m_threadCount);
+    auto previousCount = m_activeThreadCount.exchange(threadCount);
+    if (!m_lazyStart)
+        (void)startThreads(threadCount);
+    // woken workers park themselves or return to work
+    for (int i = std::min(previousCount, threadCount); i < std::max(previousCount, threadCount); ++i)
+        (void)m_threadStates[i].wakeUpIfSleeping(ThreadState::WakeUpToken::WakeUp);
+}
+
+// Returns false once a thread could not be created. Its slot and the later
+// ones stay unstarted and the running workers pick up their work.
+bool ThreadPool::startThreads(int threadCount) noexcept
+{
+    for (; m_startedThreadCount < threadCount; ++m_startedThreadCount) {
+        int threadIndex = m_startedThreadCount;
+        try {
+            m_threads.emplace_back([this, threadIndex] { runThread(threadIndex); }, m_stackSize);
+        } catch (...) {
+            return false;
+        }
     }
+    return true;
+}
+
+// Called when new work found no searching or sleeping worker to take it, also
+// retries slots whose thread failed to start
+void ThreadPool::startThreadsOnDemand(int count) noexcept
+{
+    if (count <= 0 || m_startedThreadCount >= m_activeThreadCount)
+        return;
+
+    std::unique_lock lock { m_spareMutex };
+    if (m_state != State::Started)
+        return;
+    (void)startThreads(std::min<int>(m_startedThreadCount + count, m_activeThreadCount));
+}
+
+void ThreadPool::runController() noexcept
+{
+    std::unique_lock lock { m_spareMutex };
+    while (true) {
+        m_controllerCv.wait_for(lock, s_scaleInterval);
+        if (m_state != State::Started)
+            return;
+        lock.unlock();
+        adjustThreadCount();
+        lock.lock();
+    }
+}
+
+// Hill climbing on throughput: while work queues up the pool keeps moving in
+// the direction that improved throughput and turns around when it got worse.
+// Idle workers without queued work shrink the pool.
+void ThreadPool::adjustThreadCount() noexcept
+{
+    uint64_t resumeCount = 0;
+    for (int i = 0; i < m_threadCount; ++i)
+        resumeCount += m_threadStates[i].resumeCount();
+    auto throughput = resumeCount - m_lastResumeCount;
+    m_lastResumeCount = resumeCount;
+
+    auto isBacklogged = haveWork();
+    auto haveIdleWorkers = m_sleepingThreadCount > 0;
+    int step = 0;
+    if (isBacklogged && !haveIdleWorkers) {
+        if (m_scaleStep == 0 || throughput * 20 > m_lastThroughput * 21)
+            step = m_scaleStep == 0 ? 1 : m_scaleStep;
+        else if (throughput * 20 < m_lastThroughput * 19)
+            step = -m_scaleStep;
+    } else if (!isBacklogged && haveIdleWorkers) {
+        step = -1;
+    }
+    m_lastThroughput = throughput;
+
+    auto threadCount = this->threadCount();
+    auto targetCount = std::clamp(threadCount + step, std::min(m_minThreadCount, m_threadCount), m_threadCount);
+    m_scaleStep = targetCount - threadCount;
+    if (m_scaleStep != 0)
+        resize(targetCount);
+}
+
+void ThreadPool::runThread(int threadIndex) noexcept
+{
+    while (threadIndex >= 0) {
+        runWorkerThread(threadIndex);
+        if (s_currentState)
+            return;
+        // the slot was handed off while this thread blocked, stay as a spare
+        threadIndex = waitForSlot();
+    }
+}
+
+// Gives the calling worker's slot to a spare thread, after which the thread
+// runs outside the pool. Inline and guest workers and nested resumptions keep
+// their slot, as does a worker when no spare is idle and none can be started.
+bool ThreadPool::handOffWorker() noexcept
+{
+    auto* threadPool = s_currentThreadPool;
+    if (!threadPool || s_resumeDepth != 1 || s_currentState->threadIndex() >= threadPool->m_threadCount)
+        return false;
+
+    auto* state = s_currentState;
+    auto* coroutine = s_currentCoroutine;
+    s_currentState = nullptr;
+    s_currentThreadPool = nullptr;
+    s_currentCoroutine = nullptr;
+    if (threadPool->handOffSlot(state->threadIndex()))
+        return true;
+
+    s_currentState = state;
+    s_currentThreadPool = threadPool;
+    s_currentCoroutine = coroutine;
+    return false;
+}
+
+bool ThreadPool::handOffSlot(int threadIndex) noexcept
+{
+    std::unique_lock lock { m_spareMutex };
+    if (m_idleSpareCount > 0) {
+        m_pendingSlots.push_back(threadIndex);
+        m_idleSpareCount--;
+        m_spareCv.notify_one();
+        return true;
+    }
+
+    joinRetiredThreads();
+    // every thread beyond one per started slot is a spare, blocked outside the pool or idle
+    if (static_cast<int>(m_threads.size()) - m_startedThreadCount >= m_maxSpareThreadCount)
+        return false;
+    try {
+        m_threads.emplace_back([this, threadIndex] { runThread(threadIndex); }, m_stackSize);
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+// Returns the slot to run next or -1 once the spare retires. A waker has
+// already taken the spare off the idle count for every pending slot.
+int ThreadPool::waitForSlot() noexcept
+{
+    std::unique_lock lock { m_spareMutex };
+    m_idleSpareCount++;
+    auto retireTime = std::chrono::steady_clock::now() + s_spareRetireDelay;
+    while (m_pendingSlots.empty()) {
+        auto shouldRetire = m_state == State::ShuttingDown || m_state == State::ShuttingDownImmediately
+            || m_spareCv.wait_until(lock, retireTime) == std::cv_status::timeout;
+        if (shouldRetire && m_pendingSlots.empty()) {
+            m_idleSpareCount--;
+            m_retiredThreadIds.push_back(pthread_self());
+            return -1;
+        }
+    }
+
+    auto threadIndex = m_pendingSlots.back();
+    m_pendingSlots.pop_back();
+    return threadIndex;
+}
+
+void ThreadPool::joinRetiredThreads() noexcept
+{
+    for (auto id : m_retiredThreadIds) {
+        auto it = std::find_if(m_threads.begin(), m_threads.end(),
+            [id](const WorkerThread& thread) { return thread.isThread(id); });
+        if (it == m_threads.end())
+            continue;
+        it->join();
+        m_threads.erase(it);
+    }
+    m_retiredThreadIds.clear();
+}
+
+void ThreadPool::enterInline(ThreadState& state) noexcept
+{
+    // a worker blocking on a task would stall its own queue
+    assert(!s_currentState && !s_currentThreadPool);
+    // an index no worker or guest has, so stealing never picks the calling thread itself
+    state.setThreadIndex(m_threadCount + m_guestThreadCount);
+    s_currentState = &state;
+    s_currentThreadPool = this;
+}
+
+// Takes a free guest slot, or runs on state like an inline worker when all are taken
+void ThreadPool::enterGuest(ThreadState& state) noexcept
+{
+    assert(!s_currentState && !s_currentThreadPool);
+    for (int i = 0; i < m_guestThreadCount; ++i) {
+        bool isTaken = false;
+        if (!m_guestSlots[i].load(std::memory_order_relaxed)
+            && m_guestSlots[i].compare_exchange_strong(isTaken, true, std::memory_order_acquire)) {
+            s_currentState = &m_threadStates[m_threadCount + i];
+            s_currentThreadPool = this;
+            // what the guest schedules before it starts running is its own to run first
+            s_currentState->setRunNextPrivate(true);
+            return;
+        }
+    }
+    enterInline(state);
+}
+
+// A guest's run next coroutine stays its own while it runs here, so a task
+// does not hop to a worker before the guest gets to it. Its other local work
+// is stolen as usual.
+void ThreadPool::runInline(const std::function<bool()>& isDone)
+{
+    assert(s_currentThreadPool == this);
+    s_currentState->setRunNextPrivate(true);
+    auto spinStart = std::chrono::steady_clock::now();
+    auto spinDuration = this->spinDuration();
+    SpinWait spinWait;
+    while (!isDone()) {
+        if (m_state == State::ShuttingDownImmediately)
+            break;
+
+        auto* coroutine = tryGetWork();
+        if (coroutine) {
+            resume(coroutine, ThreadState::s_maxChainedExecutionAllowance);
+            spinStart = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() - spinStart >= spinDuration)
+            break;
+        spinWait.spinOne();
+    }
+
+    // once the thread stops helping its run next coroutine is fair game
+    s_currentState->setRunNextPrivate(false);
+    if (auto* coroutine = s_currentState->tryTakeRunNext()) {
+        s_currentState->localEnqueue(coroutine);
+        setStealable(true);
+        wakeOneThread();
+    }
+}
+
+void ThreadPool::leaveInline() noexcept
+{
+    assert(s_currentThreadPool == this);
+    // nobody reaches the queues once the thread has left
+    int count = 0;
+    while (auto* coroutine = s_currentState->tryLocalPop()) {
+        globalEnqueue(coroutine);
+        count++;
+    }
+    while (auto* coroutine = s_currentState->tryTakeYielded()) {
+        globalEnqueue(coroutine);
+        count++;
+    }
+    while (auto* coroutine = s_currentState->tryDeadlinePop()) {
+        m_deadlineQueue.enqueue(coroutine);
+        count++;
+    }
+    auto guestIndex = s_currentState->threadIndex() - m_threadCount;
+    if (guestIndex < m_guestThreadCount) {
+        setStealable(false);
+        s_currentState->setRunNextPrivate(false);
+        m_guestSlots[guestIndex].store(false, std::memory_order_release);
+    }
+    s_currentState = nullptr;
+    s_currentThreadPool = nullptr;
+    s_currentCoroutine = nullptr;
+    if (count > 0)
+        wakeThreads(count);
 }
 
 void ThreadPool::setSleeping(bool isSleeping)
@@ -164,20 +575,70 @@ void ThreadPool::setSleeping(bool isSleeping)
     } else {
         s_currentState->setSleeping(false);
         m_mayBeSleepingThreadCount--;
-        if (m_mayBeSleepingThreadCount == 0)
-            m_pendingWakeUpRequestCount = 0;
     }
 }
 
+void ThreadPool::startSearching() noexcept
+{
+    assert(!s_currentState->isSearching());
+    s_currentState->setSearching(true);
+    m_searchingThreadCount++;
+}
+
+// Returns true if this was the last searching thread
+bool ThreadPool::stopSearching() noexcept
+{
+    assert(s_currentState->isSearching());
+    s_currentState->setSearching(false);
+    auto searchingThreadCount = m_searchingThreadCount.fetch_sub(1);
+    assert(searchingThreadCount > 0);
+    // pairs with the fence in wakeOneThread, either the waker sees this thread
+    // searching or this thread sees the new work
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return searchingThreadCount == 1;
+}
+
+std::chrono::nanoseconds ThreadPool::spinDuration() const noexcept
+{
+    if (m_idlePolicy == IdlePolicy::ParkImmediately)
+        return std::chrono::nanoseconds::zero();
+
+    // spinning through idle gaps longer than the limit only burns cpu, parking
+    // and paying for the wake up is cheaper then
+    std::chrono::nanoseconds averageIdleGap { m_averageIdleGap.load(std::memory_order_relaxed) };
+    if (averageIdleGap > s_maxSpinDuration)
+        return s_minSpinDuration;
+    return std::clamp(2 * averageIdleGap, s_minSpinDuration, s_maxSpinDuration);
+}
+
+void ThreadPool::recordIdleGap(std::chrono::nanoseconds idleGap) noexcept
+{
+    // beyond this every gap is simply long, clamping lets the average recover quickly
+    auto gap = std::min(idleGap, 2 * s_maxSpinDuration).count();
+    auto averageIdleGap = m_averageIdleGap.load(std::memory_order_relaxed);
+    m_averageIdleGap.store(averageIdleGap + (gap - averageIdleGap) / 8, std::memory_order_relaxed);
+}
+
 void ThreadPool::resume(Coroutine* coroutine, int chainedExecutionAllowance)
 {
     assert(s_currentState);
     assert(chainedExecutionAllowance > 0);
     s_currentState->setChainedExecutionAllowance(chainedExecutionAllowance);
-
+    auto now = std::chrono::steady_clock::now();
+    auto timeSlice = s_currentThreadPool->m_timeSlice;
+    s_currentState->setTurnEnd(timeSlice > std::chrono::nanoseconds::zero()
+            ? now + timeSlice
+            : std::chrono::steady_clock::time_point::max());
+    s_resumedCoroutine = coroutine;
+    s_resumeStart = now;
+
+    s_resumeDepth++;
+    s_currentState->recordResume();
     try {
         coroutine->resume();
+        s_resumeDepth--;
     } catch (const CancellationError& e) {
+        s_resumeDepth--;
         if (isImmediateShutdownRequested())
             return;
         printf("error resuming \n");
@@ -207,15 +668,32 @@ void ThreadPool::shutdown(State state)
 {
     assert(state == State::ShuttingDown || state == State::ShuttingDownImmediately);
 
-    m_state = state;
+    {
+        std::unique_lock lock { m_spareMutex };
+        m_state = state;
+    }
+    m_spareCv.notify_all();
+    m_controllerCv.notify_all();
+    if (m_controllerThread.joinable())
+        m_controllerThread.join();
 
-    for (int i = 0; i < m_threads.size(); ++i) {
+    for (int i = 0; i < m_threadCount; ++i) {
         auto& threadState = m_threadStates[i];
-        threadState.wakeUpIfSleeping();
+        (void)threadState.wakeUpIfSleeping(ThreadState::WakeUpToken::WakeUp);
     }
 
-    for (auto& t : m_threads) {
-        t.join();
+    // threads blocking outside the pool may still hand over to new spares
+    while (true) {
+        std::vector<WorkerThread> threads;
+        {
+            std::unique_lock lock { m_spareMutex };
+            threads.swap(m_threads);
+            m_retiredThreadIds.clear();
+        }
+        if (threads.empty())
+            break;
+        for (auto& t : threads)
+            t.join();
     }
 
     m_state = State::Terminated;
@@ -223,18 +701,63 @@ void ThreadPool::shutdown(State state)
 
 void ThreadPool::scheduleOnThreadPool(Coroutine* coroutine) noexcept
 {
-    assert(coroutine->threadPoolKind() == kind());
+    assert(&coroutine->threadPool() == this);
     if (ThreadPool::isShutdownRequested())
         coroutine->setCancelled();
 
-    if (s_currentThreadPool != this || m_noLocalWork)
-        globalEnqueue(coroutine);
-    else
-        s_currentState->localEnqueue(coroutine);
+    if (s_currentThreadPool != this || m_noLocalWork) {
+        if (coroutine->hasDeadline())
+            m_deadlineQueue.enqueue(coroutine);
+        else
+            globalEnqueue(coroutine);
+    } else {
+        // a coroutine with a deadline goes to the worker's deadline heap, which
+        // competes with the high lane ahead of run next
+        if (coroutine == s_currentCoroutine || coroutine->priority() == Priority::Low || coroutine->hasDeadline())
+            s_currentState->localEnqueue(coroutine);
+        else
+            s_currentState->runNextEnqueue(coroutine);
+        setStealable(true);
+    }
 
     wakeOneThread();
 }
 
+void ThreadPool::scheduleOnThreadPool(Coroutine* first, Coroutine* last, int count) noexcept
+{
+    assert(count > 0);
+    if (ThreadPool::isShutdownRequested()) {
+        for (auto* coroutine = first; coroutine; coroutine = coroutine->next())
+            coroutine->setCancelled();
+    }
+
+    if (s_currentThreadPool != this || m_noLocalWork) {
+        if (first->hasDeadline())
+            m_deadlineQueue.enqueueChain(first, count);
+        else
+            globalEnqueueChain(first, last, count);
+    } else {
+        s_currentState->localEnqueueChain(first, count);
+        setStealable(true);
+    }
+
+    wakeThreads(count);
+}
+
+// A yielded coroutine runs after the worker's local and remote work. Other
+// threads and pools without local work queue it globally, behind pending work.
+void ThreadPool::scheduleYielded(Coroutine* coroutine) noexcept
+{
+    assert(&coroutine->threadPool() == this);
+    if (s_currentThreadPool != this || m_noLocalWork || ThreadPool::isShutdownRequested()
+        || coroutine->hasDeadline()) {
+        scheduleOnThreadPool(coroutine);
+        return;
+    }
+
+    s_currentState->yieldedEnqueue(coroutine);
+}
+
 bool ThreadPool::isShutdownRequested() noexcept
 {
     return s_currentThreadPool
@@ -250,104 +773,217 @@ bool ThreadPool::isImmediateShutdownRequested() noexcept
 
 void ThreadPool::globalEnqueue(Coroutine* operation) noexcept
 {
-    m_globalQueue.enqueue(operation);
+    m_globalShards[submitShard()].queues[ThreadState::lane(operation)].enqueue(operation);
+}
+
+void ThreadPool::globalEnqueueChain(Coroutine* first, Coroutine* last, int count) noexcept
+{
+    // chains are built per priority
+    m_globalShards[submitShard()].queues[ThreadState::lane(first)].enqueueChain(first, last, count);
 }
 
+// A worker's home shard, for other threads one picked once per thread
+int ThreadPool::submitShard() const noexcept
+{
+    if (s_currentThreadPool == this)
+        return s_currentState->threadIndex() % m_globalShardCount;
+    return static_cast<int>(s_submitterIndex % m_globalShardCount);
+}
+
+// Lanes take precedence over shards, a high priority coroutine in another
+// shard runs before a normal one in the home shard
 Coroutine* ThreadPool::tryGlobalDequeue() noexcept
 {
-    return m_globalQueue.dequeue();
+    auto homeShard = s_currentState->threadIndex() % m_globalShardCount;
+    for (auto priority : s_currentState->laneOrder()) {
+        auto lane = static_cast<int>(priority);
+        for (int i = 0; i < m_globalShardCount; ++i) {
+            auto& queue = m_globalShards[(homeShard + i) % m_globalShardCount].queues[lane];
+            if (queue.isEmpty())
+                continue;
+            auto* coroutine = queue.dequeue();
+            if (coroutine)
+                return coroutine;
+        }
+    }
+    return nullptr;
+}
+
+// The worker's own heap and the pool's, of coroutines scheduled from other
+// threads, are each in deadline order; the earlier of the two goes first
+Coroutine* ThreadPool::tryDeadlineDequeue() noexcept
+{
+    auto isLocalFirst = s_currentState->earliestDeadline() < m_deadlineQueue.earliestDeadline();
+    auto* coroutine = isLocalFirst ? s_currentState->tryDeadlinePop() : m_deadlineQueue.dequeue();
+    if (!coroutine)
+        coroutine = isLocalFirst ? m_deadlineQueue.dequeue() : s_currentState->tryDeadlinePop();
+    // resuming a cancelled coroutine throws CancellationError at its suspension point
+    if (coroutine && coroutine->isPastDeadline())
+        coroutine->cancel();
+    return coroutine;
+}
+
+bool ThreadPool::haveGlobalWork() const noexcept
+{
+    if (!m_deadlineQueue.isEmpty())
+        return true;
+    for (int i = 0; i < m_globalShardCount; ++i) {
+        for (const auto& globalQueue : m_globalShards[i].queues) {
+            if (!globalQueue.isEmpty())
+                return true;
+        }
+    }
+    return false;
 }
 
 Coroutine* ThreadPool::tryStealFromOtherThread() noexcept
 {
     if (m_noLocalWork)
         return nullptr;
-    for (int i = 0; i < 2 * m_threadCount; i++) {
-        int otherThreadIndex = static_cast<int>(s_currentState->rand()) % m_threadCount;
-        auto& otherThreadState = m_threadStates[otherThreadIndex];
-        auto* coroutine = otherThreadState.tryLocalPop();
-        if (coroutine) {
-            return coroutine;
+
+    // prefer victims sharing the last level cache, then the NUMA node, before crossing sockets
+    auto* coroutine = tryStealFrom(s_currentState->cacheDomainPeers());
+    if (!coroutine)
+        coroutine = tryStealFrom(s_currentState->numaNodePeers());
+    if (coroutine)
+        return coroutine;
+
+    // only workers flagged in the stealable bitmap are probed, starting at a random one
+    auto start = s_currentState->rand();
+    for (int i = 0; i < m_stealableWordCount; i++) {
+        int wordIndex = static_cast<int>((start / 64 + i) % m_stealableWordCount);
+        auto candidates = m_stealableThreads[wordIndex].load(std::memory_order_acquire);
+        auto shift = static_cast<int>(start % 64);
+        while (candidates) {
+            auto bit = (std::countr_zero(std::rotr(candidates, shift)) + shift) % 64;
+            candidates &= ~(uint64_t { 1 } << bit);
+            auto* coroutine = tryStealFrom(wordIndex * 64 + bit);
+            if (coroutine)
+                return coroutine;
         }
     }
     return nullptr;
 }
 
-bool ThreadPool::wakeOneThread(bool doImmediateWakeUp) noexcept
+Coroutine* ThreadPool::tryStealFrom(const std::vector<int>& victims) noexcept
 {
-    for (int i = 0; i < m_threadCount; ++i) {
-        if (m_mayBeSleepingThreadCount == 0)
-            return true;
-
-        auto success = doImmediateWakeUp
-            ? m_threadStates[i].wakeUpIfSleeping()
-            : m_threadStates[i].tryWakeUpIfSleeping();
-
-        if (success)
-            return true;
+    if (victims.empty())
+        return nullptr;
+    auto start = s_currentState->rand();
+    for (size_t i = 0; i < victims.size(); i++) {
+        auto victimIndex = victims[(start + i) % victims.size()];
+        if (!isStealable(victimIndex))
+            continue;
+        auto* coroutine = tryStealFrom(victimIndex);
+        if (coroutine)
+            return coroutine;
     }
-    return false;
+    return nullptr;
 }
 
-void ThreadPool::wakeOneThread() noexcept
+Coroutine* ThreadPool::tryStealFrom(int victimIndex) noexcept
 {
-    bool doImmediateWakeUp = !s_currentThreadPool || s_currentThreadPool->noLocalWork()
-        || (s_currentThreadPool != this && m_mayBeSleepingThreadCount == m_threadCount);
+    if (victimIndex == s_currentState->threadIndex())
+        return nullptr;
+    auto* coroutine = m_threadStates[victimIndex].tryStealHalf(*s_currentState);
+    // the rest of the stolen half is now in this thread's queues
+    if (coroutine && s_currentState->haveLocalWork())
+        setStealable(true);
+    return coroutine;
+}
 
-    bool success = wakeOneThread(doImmediateWakeUp);
-    if (success)
+void ThreadPool::setStealable(bool isStealable) noexcept
+{
+    auto threadIndex = s_currentState->threadIndex();
+    // an inline worker's queues are not reachable by other threads
+    if (threadIndex >= m_threadCount + m_guestThreadCount)
         return;
-
-    if (doImmediateWakeUp)
+    auto& word = m_stealableThreads[threadIndex / 64];
+    auto mask = uint64_t { 1 } << (threadIndex % 64);
+    if (((word.load(std::memory_order_relaxed) & mask) != 0) == isStealable)
         return;
-    if (m_mayBeSleepingThreadCount == 0)
+    if (isStealable)
+        word.fetch_or(mask, std::memory_order_release);
+    else
+        word.fetch_and(~mask, std::memory_order_relaxed);
+}
+
+bool ThreadPool::isStealable(int threadIndex) const noexcept
+{
+    auto word = m_stealableThreads[threadIndex / 64].load(std::memory_order_acquire);
+    return (word & (uint64_t { 1 } << (threadIndex % 64))) != 0;
+}
+
+void ThreadPool::wakeOneThread() noexcept
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_searchingThreadCount != 0)
         return;
-    if (s_currentThreadPool && s_currentThreadPool != this
-        && m_mayBeSleepingThreadCount == m_threadCount && m_pendingWakeUpRequestCount > 0) {
-        (void)wakeOneThread(true);
+    if (m_mayBeSleepingThreadCount == 0) {
+        startThreadsOnDemand(1);
         return;
     }
 
-    int pendingWakeUpRequestCount = m_pendingWakeUpRequestCount;
-    do {
-        assert(pendingWakeUpRequestCount >= 0);
-        assert(pendingWakeUpRequestCount <= m_threadCount);
-        if (pendingWakeUpRequestCount >= m_mayBeSleepingThreadCount)
+    // the woken thread takes over this searching slot, so concurrent wakers
+    // back off until it finds work
+    int searchingThreadCount = 0;
+    if (!m_searchingThreadCount.compare_exchange_strong(searchingThreadCount, 1))
+        return;
+
+    int activeThreadCount = m_activeThreadCount;
+    for (int i = 0; i < activeThreadCount; ++i) {
+        if (m_threadStates[i].wakeUpIfSleeping(ThreadState::WakeUpToken::Search))
             return;
-    } while (!m_pendingWakeUpRequestCount.compare_exchange_weak(
-        pendingWakeUpRequestCount, pendingWakeUpRequestCount + 1));
+    }
+    m_searchingThreadCount--;
 }
 
-void ThreadPool::processPendingWakeUps() noexcept
+// Wakes enough sleepers for count new coroutines, counting the searching threads
+void ThreadPool::wakeThreads(int count) noexcept
 {
-    assert(m_pendingWakeUpRequestCount >= 0);
-    assert(m_pendingWakeUpRequestCount <= m_threadCount);
+    if (count == 1) {
+        wakeOneThread();
+        return;
+    }
 
-    int pendingWakeUpRequestCount = m_pendingWakeUpRequestCount;
-    do {
-        assert(pendingWakeUpRequestCount >= 0);
-        if (pendingWakeUpRequestCount == 0)
-            return;
-    } while (!m_pendingWakeUpRequestCount.compare_exchange_weak(
-        pendingWakeUpRequestCount, pendingWakeUpRequestCount - 1));
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int activeThreadCount = m_activeThreadCount;
+    int wakeCount = std::min(count, activeThreadCount) - m_searchingThreadCount;
+    for (int i = 0; i < activeThreadCount && wakeCount > 0; ++i) {
+        if (m_mayBeSleepingThreadCount == 0)
+            break;
+        if (!m_threadStates[i].isSleeping())
+            continue;
 
-    wakeOneThread();
+        m_searchingThreadCount++;
+        if (m_threadStates[i].wakeUpIfSleeping(ThreadState::WakeUpToken::Search))
+            wakeCount--;
+        else
+            m_searchingThreadCount--;
+    }
+    startThreadsOnDemand(wakeCount);
 }
 
 bool ThreadPool::haveWork() const noexcept
 {
-    bool haveWork = !m_globalQueue.isEmpty();
+    bool haveWork = haveGlobalWork();
     if (m_noLocalWork)
         return haveWork;
-    for (int i = 0; i < m_threadCount; ++i) {
+    for (int i = 0; i < m_threadCount + m_guestThreadCount; ++i) {
         haveWork = haveWork || m_threadStates[i].haveLocalWork();
     }
     return haveWork;
 }
 
+// Workers not started yet count as sleeping
 int ThreadPool::sleepingThreadCount() const noexcept
 {
-    return m_sleepingThreadCount;
+    return m_sleepingThreadCount + std::max(0, m_activeThreadCount - m_startedThreadCount);
+}
+
+int ThreadPool::searchingThreadCount() const noexcept
+{
+    return m_searchingThreadCount;
 }
 
 void ThreadPool::waitForAllThreadsIdle()
@@ -362,16 +998,21 @@ void ThreadPool::waitForAllThreadsIdle()
         spinWait.spinOne();
 }
 
-int ThreadPool::maxThreadCount() noexcept
+int ThreadPool::threadCount() const noexcept
 {
-    return s_maxThreadCount;
+    return m_activeThreadCount;
 }
 
-int ThreadPool::threadCount() const noexcept
+int ThreadPool::maxThreadCount() const noexcept
 {
     return m_threadCount;
 }
 
+int ThreadPool::startedThreadCount() const noexcept
+{
+    return m_startedThreadCount;
+}
+
 ThreadPool* ThreadPool::currentThreadPool() noexcept
 {
     return s_currentThreadPool;
@@ -382,6 +1023,34 @@ bool ThreadPool::canDoChainedExecution() noexcept
     return !s_currentState || s_currentState->chainedExecutionAllowance() > 0;
 }
 
+bool ThreadPool::isTurnOver() noexcept
+{
+    return s_currentState && s_currentState->checkTurnOver();
+}
+
+// Measures the resumption that is suspending now. A coroutine that ran past the
+// migration threshold s_migrationRunCount times in a row moves to the pool's
+// migration pool for good, its awaiter then schedules it there. Inline and
+// guest workers keep their coroutines, as do coroutines placed on a pool explicitly.
+void ThreadPool::recordRunTime(Coroutine& coroutine) noexcept
+{
+    auto* threadPool = s_currentThreadPool;
+    if (s_resumedCoroutine != &coroutine || !threadPool || !threadPool->m_migrationPool
+        || &coroutine.threadPool() != threadPool || coroutine.m_isThreadPoolPinned
+        || s_currentState->threadIndex() >= threadPool->m_threadCount)
+        return;
+    s_resumedCoroutine = nullptr;
+
+    if (std::chrono::steady_clock::now() - s_resumeStart < threadPool->m_migrationThreshold) {
+        coroutine.m_longRunCount = 0;
+        return;
+    }
+    if (++coroutine.m_longRunCount < s_migrationRunCount)
+        return;
+    coroutine.m_longRunCount = 0;
+    coroutine.setThreadPool(*threadPool->m_migrationPool, false);
+}
+
 void ThreadPool::recordChainedExecution() noexcept
 {
     assert(s_currentState);
@@ -400,8 +1069,10 @@ void ThreadPool::yield()
     if (coroutine) {
         auto* currentCoroutine = ThreadPool::currentCoroutine();
         auto allowance = s_currentState->chainedExecutionAllowance();
+        auto turnEnd = s_currentState->turnEnd();
         resume(coroutine, 1);
         s_currentState->setChainedExecutionAllowance(allowance);
+        s_currentState->setTurnEnd(turnEnd);
         ThreadPool::setCurrentCoroutine(currentCoroutine);
     } else {
         std::this_thread::yield();
@@ -440,6 +1111,82 @@ ThreadPoolKind ThreadPool::currentThreadPoolKind() noexcept
     return currentThreadPool()->kind();
 }
 
+const std::string& ThreadPool::name() const noexcept
+{
+    return m_name;
+}
+
+void ThreadPool::setCurrentThreadName(int threadIndex) const noexcept
+{
+    if (m_name.empty())
+        return;
+    // Linux limits thread names to 15 characters
+    auto threadName = (m_name + "-" + std::to_string(threadIndex)).substr(0, 15);
+#if defined(__APPLE__)
+    pthread_setname_np(threadName.c_str());
+#elif defined(__linux__)
+    pthread_setname_np(pthread_self(), threadName.c_str());
+#endif
+}
+
+void ThreadPool::setCurrentThreadAffinity(int threadIndex) const noexcept
+{
+    auto cpu = m_threadStates[threadIndex].cpu();
+    if (cpu != -1)
+        (void)CpuTopology::setCurrentThreadAffinity({ cpu });
+    else if (!m_cpuSet.empty())
+        (void)CpuTopology::setCurrentThreadAffinity(m_cpuSet);
+}
+
+void ThreadPool::placeWorkers(const std::vector<int>& cpuSet)
+{
+    auto cpus = CpuTopology::cpus(cpuSet);
+    if (cpus.empty())
+        return;
+
+    // cpus are ordered by NUMA node and cache domain, so filling them in order
+    // keeps a small pool within as few domains as possible
+    auto cpuOf = [&](int threadIndex) -> const CpuTopology::Cpu& {
+        return cpus[threadIndex % cpus.size()];
+    };
+
+    for (int i = 0; i < m_threadCount; ++i) {
+        const auto& cpu = cpuOf(i);
+        std::vector<int> cacheDomainPeers;
+        std::vector<int> numaNodePeers;
+        for (int j = 0; j < m_threadCount; ++j) {
+            if (j == i || cpuOf(j).numaNode != cpu.numaNode)
+                continue;
+            if (cpuOf(j).cacheDomain == cpu.cacheDomain)
+                cacheDomainPeers.push_back(j);
+            else
+                numaNodePeers.push_back(j);
+        }
+        m_threadStates[i].setPlacement(cpu.id, std::move(cacheDomainPeers), std::move(numaNodePeers));
+    }
+}
+
+ThreadPool& ThreadPool::defaultThreadPool() noexcept
+{
+    static ThreadPool s_threadPool { ThreadPoolOptions {
+        .name = "default",
+        .threadCount = static_cast<int>(std::thread::hardware_concurrency()),
+        .kind = ThreadPoolKind::Default,
+        .lazyStart = true,
+        .migrationPool = &backgroundThreadPool() } };
+    return s_threadPool;
+}
+
+ThreadPool& ThreadPool::backgroundThreadPool() noexcept
+{
+    static ThreadPool s_threadPool { ThreadPoolOptions {
+        .name = "background",
+        .threadCount = s_backgroundThreadCount,
+        .kind = ThreadPoolKind::Background,
+        .lazyStart = true } };
+    return s_threadPool;
+}
+
 ThreadPool& ThreadPool::threadPool(ThreadPoolKind kind) noexcept
 {
     if (kind == ThreadPoolKind::Background)
@@ -5,22 +5,31 @@
 #ifndef LEVELZ_THREAD_POOL_HPP
 #define LEVELZ_THREAD_POOL_HPP
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <coroutine>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "coroutine.hpp"
+#include "deadline_queue.hpp"
 #include "fifo_wait_list.hpp"
 #include "thread_pool_kind.hpp"
+#include "thread_pool_options.hpp"
 #include "thread_state.hpp"
+#include "worker_thread.hpp"
 
 namespace Levelz::Async {
 
 struct ThreadPool {
     ThreadPool(int threadCount, ThreadPoolKind kind);
+    explicit ThreadPool(const ThreadPoolOptions& options);
 
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool(ThreadPool&&) = delete;
@@ -32,17 +41,24 @@ struct ThreadPool {
     void shutdown();
     void shutdownImmediately();
     int threadCount() const noexcept;
+    int maxThreadCount() const noexcept;
+    int startedThreadCount() const noexcept;
+    void resize(int threadCount);
     bool haveWork() const noexcept;
     int sleepingThreadCount() const noexcept;
+    int searchingThreadCount() const noexcept;
     bool noLocalWork() const noexcept;
     ThreadPoolKind kind() const noexcept;
+    const std::string& name() const noexcept;
 
-    static int maxThreadCount() noexcept;
     static void waitForAllThreadsIdle();
     static bool isShutdownRequested() noexcept;
     static bool isImmediateShutdownRequested() noexcept;
     static void shutdownAll();
     static ThreadPoolKind currentThreadPoolKind() noexcept;
+    static ThreadPool* currentThreadPool() noexcept;
+    static ThreadPool& defaultThreadPool() noexcept;
+    static ThreadPool& backgroundThreadPool() noexcept;
 
 private:
     enum class State {
@@ -58,48 +74,152 @@ private:
     friend struct TaskPromiseFinalSuspendAwaiter;
     friend struct AsyncSpinWait;
     friend struct Awaiter;
+    friend struct ScheduleBatch;
+    friend struct InlineWorker;
+    friend struct GuestWorker;
+    friend struct YieldAwaiter;
+    template <typename>
+    friend struct BlockingAwaiter;
 
     void setSleeping(bool isSleeping);
+    void startSearching() noexcept;
+    [[nodiscard]] bool stopSearching() noexcept;
+    std::chrono::nanoseconds spinDuration() const noexcept;
+    void recordIdleGap(std::chrono::nanoseconds idleGap) noexcept;
+    void runThread(int threadIndex) noexcept;
     void runWorkerThread(int threadIndex) noexcept;
+    bool isActive(int threadIndex) const noexcept;
+    void parkWorker(ThreadState& state) noexcept;
+    [[nodiscard]] bool startThreads(int threadCount) noexcept;
+    void startThreadsOnDemand(int count) noexcept;
+    void runController() noexcept;
+    void adjustThreadCount() noexcept;
+    static bool handOffWorker() noexcept;
+    [[nodiscard]] bool handOffSlot(int threadIndex) noexcept;
+    int waitForSlot() noexcept;
+    void joinRetiredThreads() noexcept;
+    void setCurrentThreadName(int threadIndex) const noexcept;
+    void setCurrentThreadAffinity(int threadIndex) const noexcept;
+    void placeWorkers(const std::vector<int>& cpuSet);
     void shutdown(State state);
+    void enterInline(ThreadState& state) noexcept;
+    void enterGuest(ThreadState& state) noexcept;
+    void runInline(const std::function<bool()>& isDone);
+    void leaveInline() noexcept;
 
     void globalEnqueue(Coroutine* operation) noexcept;
+    void globalEnqueueChain(Coroutine* first, Coroutine* last, int count) noexcept;
     Coroutine* tryGlobalDequeue() noexcept;
+    int submitShard() const noexcept;
+    bool haveGlobalWork() const noexcept;
+    Coroutine* tryDeadlineDequeue() noexcept;
     Coroutine* tryStealFromOtherThread() noexcept;
+    Coroutine* tryStealFrom(const std::vector<int>& victims) noexcept;
+    Coroutine* tryStealFrom(int victimIndex) noexcept;
+    void setStealable(bool isStealable) noexcept;
+    bool isStealable(int threadIndex) const noexcept;
     static void yield();
 
     void wakeOneThread() noexcept;
-    [[nodiscard]] bool wakeOneThread(bool doImmediateWakeUp) noexcept;
-    void processPendingWakeUps() noexcept;
+    void wakeThreads(int count) noexcept;
     Coroutine* tryGetRemote() noexcept;
     Coroutine* tryGetWork() noexcept;
     static void resume(Coroutine* coroutine, int chainedExecutionAllowance);
     void scheduleOnThreadPool(Coroutine* coroutine) noexcept;
+    void scheduleOnThreadPool(Coroutine* first, Coroutine* last, int count) noexcept;
+    void scheduleYielded(Coroutine* coroutine) noexcept;
     static bool canDoChainedExecution() noexcept;
+    static bool isTurnOver() noexcept;
+    static void recordRunTime(Coroutine& coroutine) noexcept;
     static void recordChainedExecution() noexcept;
     static Coroutine* currentCoroutine() noexcept;
     static void setCurrentCoroutine(Coroutine* coroutine) noexcept;
     static ThreadPool& threadPool(ThreadPoolKind kind) noexcept;
-    static ThreadPool* currentThreadPool() noexcept;
 
     static thread_local ThreadState* s_currentState;
     static thread_local ThreadPool* s_currentThreadPool;
     static thread_local Coroutine* s_currentCoroutine;
+    static thread_local uint32_t s_submitterIndex;
+    static thread_local int s_resumeDepth;
+    static thread_local Coroutine* s_resumedCoroutine;
+    static thread_local std::chrono::steady_clock::time_point s_resumeStart;
+    static std::atomic<uint32_t> s_nextSubmitterIndex;
+
+    // one queue per priority lane, indexed by Priority, on its own cache lines
+    struct alignas(64) GlobalShard {
+        std::array<FifoWaitList, 3> queues;
+    };
 
     std::atomic<State> m_state;
+    // Worker slots, one thread state each. Slots beyond the active count park
+    // their worker until the pool grows again.
     const int m_threadCount;
+    std::atomic<int> m_activeThreadCount;
+    // Guest slots follow the worker slots, an external thread joining the pool
+    // runs on one so workers can steal what it schedules
+    const int m_guestThreadCount;
+    const std::unique_ptr<std::atomic<bool>[]> m_guestSlots;
     const std::unique_ptr<ThreadState[]> m_threadStates;
-    std::vector<std::thread> m_threads;
+    // A bit per worker that may have local work to steal. Only the owner sets
+    // and clears its bit, so a set bit can be stale but work is never hidden
+    // from thieves for longer than the owner's next empty pop.
+    const int m_stealableWordCount;
+    const std::unique_ptr<std::atomic<uint64_t>[]> m_stealableThreads;
+    // Worker threads and spares. A worker about to block hands its slot, the
+    // thread state of its index, to a spare so the pool keeps its capacity;
+    // spares without a slot retire after a while.
+    std::vector<WorkerThread> m_threads;
+    std::mutex m_spareMutex;
+    std::condition_variable m_spareCv;
+    std::vector<int> m_pendingSlots;
+    std::vector<pthread_t> m_retiredThreadIds;
+    int m_idleSpareCount;
+    const int m_maxSpareThreadCount;
+    // Slots that have had a thread, later slots get one when the pool first
+    // grows into them or, for lazily started pools, when work finds no idle worker
+    std::atomic<int> m_startedThreadCount;
+    const bool m_lazyStart;
+    const size_t m_stackSize;
+
+    const int m_minThreadCount;
+    std::thread m_controllerThread;
+    std::condition_variable m_controllerCv;
+    // controller thread only
+    uint64_t m_lastResumeCount;
+    uint64_t m_lastThroughput;
+    int m_scaleStep;
 
     std::atomic<int> m_mayBeSleepingThreadCount;
     std::atomic<int> m_sleepingThreadCount;
-
-    FifoWaitList m_globalQueue;
+    // workers spinning for remote work, new work only wakes a sleeper when there are none
+    std::atomic<int> m_searchingThreadCount;
+
+    // Coroutines scheduled from outside the pool, and all coroutines of a pool
+    // without local work. Workers submit to and drain their own shard first,
+    // other threads are spread over the shards so no single head pointer is
+    // contended.
+    const int m_globalShardCount;
+    const std::unique_ptr<GlobalShard[]> m_globalShards;
+    // coroutines with a deadline bypass the lanes and run earliest deadline
+    // first. Like the global queues, this one takes those scheduled from outside
+    // the pool and all of a pool without local work; workers keep their own.
+    DeadlineQueue m_deadlineQueue;
     const bool m_noLocalWork;
     const ThreadPoolKind m_kind;
-    std::atomic<int> m_pendingWakeUpRequestCount;
-
-    static constexpr int s_numRemoteWorksChecksBeforeSleep = 32;
+    const std::string m_name;
+    const std::vector<int> m_cpuSet;
+    const IdlePolicy m_idlePolicy;
+    const std::chrono::nanoseconds m_timeSlice;
+    ThreadPool* const m_migrationPool;
+    const std::chrono::nanoseconds m_migrationThreshold;
+    // exponentially weighted moving average of how long workers stay idle, in nanoseconds
+    std::atomic<int64_t> m_averageIdleGap;
+
+    static constexpr std::chrono::nanoseconds s_minSpinDuration = std::chrono::microseconds { 2 };
+    static constexpr std::chrono::nanoseconds s_maxSpinDuration = std::chrono::microseconds { 50 };
+    static constexpr std::chrono::nanoseconds s_spareRetireDelay = std::chrono::seconds { 2 };
+    static constexpr std::chrono::nanoseconds s_scaleInterval = std::chrono::milliseconds { 100 };
+    static constexpr int s_migrationRunCount = 3;
 };
 
 }
@@ -0,0 +1,57 @@
+#ifndef LEVELZ_THREAD_POOL_OPTIONS_HPP
+#define LEVELZ_THREAD_POOL_OPTIONS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "idle_policy.hpp"
+#include "thread_pool_kind.hpp"
+
+namespace Levelz::Async {
+
+struct ThreadPool;
+
+struct ThreadPoolOptions {
+    std::string name {};
+    int threadCount = 1;
+    // resize() and autoScale may grow the pool up to this many workers, at least threadCount
+    int maxThreadCount = 0;
+    // the fewest workers autoScale shrinks the pool to
+    int minThreadCount = 1;
+    // Adjust the worker count periodically, growing while queued work piles up
+    // and throughput improves, shrinking when workers sit idle
+    bool autoScale = false;
+    // external threads that can join at once as guest workers, see GuestWorker
+    int guestThreadCount = 4;
+    // Background pools have no local queues, every coroutine goes through the global queue
+    ThreadPoolKind kind = ThreadPoolKind::Default;
+    // cpus the workers may run on, empty means no restriction
+    std::vector<int> cpuSet {};
+    // Pin every worker to a single cpu of cpuSet (all cpus when empty). Workers are
+    // placed grouped by NUMA node and cache domain and steal from their own domain first.
+    bool pinWorkers = false;
+    IdlePolicy idlePolicy = IdlePolicy::Adaptive;
+    // start workers as work arrives rather than all at construction
+    bool lazyStart = false;
+    // Threads started beyond the workers to take over the slot of a worker
+    // blocked in runBlocking. Past the limit a blocking worker keeps its slot.
+    int maxSpareThreadCount = 64;
+    // worker stack size in bytes, zero for the platform default
+    size_t stackSize = 0;
+    // A coroutine chain resumed by a worker is rescheduled at its next await
+    // point once it ran this long, so queued work gets a turn. Zero disables it.
+    std::chrono::nanoseconds timeSlice = std::chrono::milliseconds { 2 };
+    // Coroutines that keep running longer than migrationThreshold between
+    // suspensions move to migrationPool at their next await and stay there.
+    // None when null. Coroutines of a fixed ThreadPoolKind or placed with
+    // RunOn or resumeOn never move, nor do those running on inline or guest
+    // workers. The default pool migrates to the background pool.
+    ThreadPool* migrationPool = nullptr;
+    std::chrono::nanoseconds migrationThreshold = std::chrono::milliseconds { 2 };
+};
+
+}
+
+#endif // LEVELZ_THREAD_POOL_OPTIONS_HPP
@@ -2,24 +2,131 @@
 // Created by irantha on 5/4/23.
 //
 
+#include <algorithm>
+#include <array>
 #include <catch2/catch_test_macros.hpp>
 #include <iostream>
+#include <mutex>
+#include <numeric>
+#include <random>
 #include <thread>
 #include <vector>
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "blocking_awaiter.hpp"
+#include "cpu_topology.hpp"
+#include "deadline_scope.hpp"
+#include "event/async_event.hpp"
+#include "event/async_value.hpp"
+#include "guest_worker.hpp"
+#include "priority_scope.hpp"
+#include "resume_on_awaiter.hpp"
+#include "spin_wait.hpp"
 #include "task/async_task.hpp"
+#include "task/block_on.hpp"
 #include "task/sync_task.hpp"
 #include "task/task.hpp"
 #include "test/async_test_utils.hpp"
 #include "thread_pool.hpp"
+#include "work_item.hpp"
+#include "yield_awaiter.hpp"
 
 namespace Levelz::Async::Test {
 
 TEST_CASE("ThreadPool - construct/destruct", "[ThreadPool]")
 {
     ThreadPool threadPool { 5, ThreadPoolKind::Default };
-    REQUIRE(threadPool.threadCount() == std::min(5, ThreadPool::maxThreadCount()));
+    REQUIRE(threadPool.threadCount() == 5);
+}
+
+TEST_CASE("ThreadPool - construct with options", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "wide", .threadCount = 64 } };
+    REQUIRE(threadPool.threadCount() == 64);
+    REQUIRE(threadPool.name() == "wide");
+    REQUIRE(threadPool.kind() == ThreadPoolKind::Default);
+}
+
+TEST_CASE("ThreadPool - tasks run on user thread pool", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "user", .threadCount = 3 } };
+    ThreadPool backgroundThreadPool { ThreadPoolOptions {
+        .name = "user-bg", .threadCount = 2, .kind = ThreadPoolKind::Background } };
+
+    auto child = []() -> Task<ThreadPool*> {
+        co_return ThreadPool::currentThreadPool();
+    };
+
+    auto asyncChild = [](RunOn) -> Async<ThreadPool*> {
+        co_return ThreadPool::currentThreadPool();
+    };
+
+    auto defaultChild = []() -> DefaultTask<ThreadPool*> {
+        co_return ThreadPool::currentThreadPool();
+    };
+
+    // without RunOn a pool argument does not move the coroutine
+    auto plainChild = [](ThreadPool&) -> Async<ThreadPool*> {
+        co_return ThreadPool::currentThreadPool();
+    };
+
+    auto run = [&](RunOn pool) -> Sync<bool> {
+        bool onPool = ThreadPool::currentThreadPool() == &pool.threadPool();
+        auto* childPool = co_await child();
+        auto* asyncChildPool = co_await asyncChild(backgroundThreadPool);
+        auto* defaultChildPool = co_await defaultChild();
+        auto* plainChildPool = co_await plainChild(backgroundThreadPool);
+        co_return onPool && childPool == &pool.threadPool()
+            && asyncChildPool == &backgroundThreadPool
+            && plainChildPool == &pool.threadPool()
+            && defaultChildPool == &ThreadPool::defaultThreadPool()
+            && ThreadPool::currentThreadPool() == &pool.threadPool();
+    };
+
+    REQUIRE(run(threadPool).get());
+    REQUIRE(run(backgroundThreadPool).get());
+}
+
+TEST_CASE("ThreadPool - cpu topology", "[ThreadPool]")
+{
+    auto cpus = CpuTopology::cpus({});
+    REQUIRE(!cpus.empty());
+    for (size_t i = 1; i < cpus.size(); ++i) {
+        REQUIRE(cpus[i - 1].numaNode <= cpus[i].numaNode);
+        if (cpus[i - 1].numaNode == cpus[i].numaNode)
+            REQUIRE(cpus[i - 1].cacheDomain <= cpus[i].cacheDomain);
+    }
+
+    auto cpuSet = CpuTopology::cpus({ cpus[0].id, cpus[0].id });
+    REQUIRE(cpuSet.size() == 1);
+    REQUIRE(cpuSet[0].id == cpus[0].id);
+}
+
+#if defined(__linux__)
+TEST_CASE("ThreadPool - pinned workers", "[ThreadPool]")
+{
+    auto cpu = CpuTopology::cpus({}).back().id;
+    ThreadPool threadPool { ThreadPoolOptions {
+        .name = "pinned", .threadCount = 3, .cpuSet = { cpu }, .pinWorkers = true } };
+
+    auto child = []() -> Task<int> {
+        co_return sched_getcpu();
+    };
+
+    auto run = [&](RunOn) -> Sync<bool> {
+        bool pinned = true;
+        for (int i = 0; i < 100; ++i)
+            pinned = pinned && co_await child() == cpu;
+        co_return pinned;
+    };
+
+    REQUIRE(run(threadPool).get());
 }
+#endif
 
 TEST_CASE("ThreadPool - one task", "[ThreadPool]")
 {
@@ -101,6 +208,747 @@ TEST_CASE("ThreadPool - sync task thread pool switching", "[ThreadPool]")
     REQUIRE(ThreadPool::currentThreadPoolKind() == ThreadPoolKind::Current);
 }
 
+TEST_CASE("ThreadPool - searching threads settle when idle", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "searching", .threadCount = 4 } };
+    std::atomic<int> value;
+
+    auto task = [&](RunOn) -> Async<> {
+        AsyncTestUtils::randomSpinWait(100);
+        value++;
+        co_return;
+    };
+
+    auto runner = [&](RunOn pool) -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (int i = 0; i < 1000; i++)
+            tasks.push_back(task(pool));
+        for (auto& t : tasks)
+            co_await t;
+    };
+
+    runner(threadPool).get();
+    REQUIRE(value == 1000);
+
+    SpinWait spinWait;
+    while (threadPool.sleepingThreadCount() < threadPool.threadCount())
+        spinWait.spinOne();
+    REQUIRE(threadPool.searchingThreadCount() == 0);
+}
+
+TEST_CASE("ThreadPool - idle policies", "[ThreadPool]")
+{
+    for (auto idlePolicy : { IdlePolicy::Adaptive, IdlePolicy::BusyPoll, IdlePolicy::ParkImmediately }) {
+        ThreadPool threadPool { ThreadPoolOptions { .name = "idle", .threadCount = 2, .idlePolicy = idlePolicy } };
+        std::atomic<int> value;
+
+        auto task = [&](RunOn) -> Async<> {
+            value++;
+            co_return;
+        };
+
+        auto runner = [&](RunOn pool) -> Sync<> {
+            for (int i = 0; i < 100; i++) {
+                co_await task(pool);
+                std::this_thread::sleep_for(std::chrono::microseconds { 10 });
+            }
+        };
+
+        runner(threadPool).get();
+        REQUIRE(value == 100);
+        if (idlePolicy == IdlePolicy::BusyPoll)
+            REQUIRE(threadPool.sleepingThreadCount() == 0);
+    }
+}
+
+TEST_CASE("ThreadPool - ping pong hand-offs", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "ping-pong", .threadCount = 2 } };
+    constexpr int count = 1000;
+    std::vector<AsyncValue<int>> pings(count);
+    std::vector<AsyncValue<int>> pongs(count);
+
+    auto pong = [&](RunOn) -> Async<> {
+        for (int i = 0; i < count; i++) {
+            auto value = co_await pings[i];
+            pongs[i].setAndSignal(value + 1);
+        }
+    };
+
+    auto ping = [&](RunOn pool) -> Sync<int> {
+        auto pongTask = pong(pool);
+        int sum = 0;
+        for (int i = 0; i < count; i++) {
+            pings[i].setAndSignal(i);
+            sum += co_await pongs[i];
+        }
+        co_await pongTask;
+        co_return sum;
+    };
+
+    REQUIRE(ping(threadPool).get() == count * (count + 1) / 2);
+}
+
+TEST_CASE("ThreadPool - priority is inherited and scoped", "[ThreadPool]")
+{
+    auto child = []() -> Task<Priority> {
+        co_return Coroutine::currentCoroutine()->priority();
+    };
+
+    auto run = [&]() -> Sync<bool> {
+        bool inherited = co_await child() == Priority::High;
+        {
+            PriorityScope priorityScope { Priority::Low };
+            inherited = inherited && co_await child() == Priority::Low;
+        }
+        co_return inherited && co_await child() == Priority::High;
+    };
+
+    {
+        PriorityScope priorityScope { Priority::High };
+        REQUIRE(run().get());
+    }
+    REQUIRE(Coroutine::currentPriority() == Priority::Normal);
+}
+
+TEST_CASE("ThreadPool - higher priority lanes run first", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "lanes", .threadCount = 1 } };
+    constexpr int count = 20;
+    std::vector<Priority> order;
+
+    auto task = [&](RunOn) -> Async<> {
+        order.push_back(Coroutine::currentCoroutine()->priority());
+        co_return;
+    };
+
+    auto run = [&](RunOn pool) -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (auto priority : { Priority::Low, Priority::High }) {
+            PriorityScope priorityScope { priority };
+            for (int i = 0; i < count; i++)
+                tasks.push_back(task(pool));
+        }
+        for (auto& t : tasks)
+            co_await t;
+    };
+
+    run(threadPool).get();
+    REQUIRE(order.size() == 2 * count);
+    // the low lane may get a single anti-starvation turn
+    auto highFirst = std::count(order.begin(), order.begin() + count, Priority::High);
+    REQUIRE(highFirst >= count - 1);
+}
+
+TEST_CASE("ThreadPool - earliest deadline first", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "edf", .threadCount = 1 } };
+    constexpr int count = 200;
+    std::vector<int> offsets(count);
+    std::iota(offsets.begin(), offsets.end(), 1);
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937 { 7 });
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::chrono::steady_clock::time_point> order;
+
+    auto task = [&](RunOn) -> Async<> {
+        order.push_back(Coroutine::currentCoroutine()->deadline());
+        co_return;
+    };
+
+    auto run = [&](RunOn pool) -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (int i : offsets) {
+            DeadlineScope deadlineScope { now + std::chrono::hours { 1 } + std::chrono::seconds { i } };
+            tasks.push_back(task(pool));
+        }
+        for (auto& t : tasks)
+            co_await t;
+    };
+
+    run(threadPool).get();
+    REQUIRE(order.size() == count);
+    REQUIRE(std::is_sorted(order.begin(), order.end()));
+}
+
+TEST_CASE("ThreadPool - woken waiters run earliest deadline first", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "edfWake", .threadCount = 1 } };
+    constexpr int count = 200;
+    std::vector<int> offsets(count);
+    std::iota(offsets.begin(), offsets.end(), 1);
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937 { 11 });
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::chrono::steady_clock::time_point> order;
+    AsyncEvent event;
+    AsyncEvent allWaiting;
+    int waitingCount = 0;
+
+    auto waiter = [&](RunOn) -> Async<> {
+        // the single worker runs the last waiter up to its wait before the signal
+        if (++waitingCount == count)
+            allWaiting.signal();
+        co_await event;
+        order.push_back(Coroutine::currentCoroutine()->deadline());
+    };
+
+    auto run = [&](RunOn pool) -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (int i : offsets) {
+            DeadlineScope deadlineScope { now + std::chrono::hours { 1 } + std::chrono::seconds { i } };
+            tasks.push_back(waiter(pool));
+        }
+        co_await allWaiting;
+        // wakes them as one batch into the worker's deadline heap
+        event.signal();
+        for (auto& t : tasks)
+            co_await t;
+    };
+
+    run(threadPool).get();
+    REQUIRE(order.size() == count);
+    REQUIRE(std::is_sorted(order.begin(), order.end()));
+}
+
+TEST_CASE("ThreadPool - deadline work is stolen", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "edfSteal", .threadCount = 4 } };
+    constexpr int count = 64;
+    std::mutex mutex;
+    std::vector<std::thread::id> threadIds;
+
+    auto child = [&](RunOn) -> Async<> {
+        std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+        std::unique_lock lock { mutex };
+        threadIds.push_back(std::this_thread::get_id());
+        co_return;
+    };
+
+    auto run = [&](RunOn pool) -> Sync<> {
+        DeadlineScope deadlineScope { std::chrono::hours { 1 } };
+        std::vector<Async<>> tasks;
+        for (int i = 0; i < count; ++i)
+            tasks.push_back(child(pool));
+        for (auto& t : tasks)
+            co_await t;
+    };
+
+    run(threadPool).get();
+    REQUIRE(threadIds.size() == count);
+    std::sort(threadIds.begin(), threadIds.end());
+    REQUIRE(std::unique(threadIds.begin(), threadIds.end()) - threadIds.begin() > 1);
+}
+
+TEST_CASE("ThreadPool - spent time slice lets queued work run", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions {
+        .name = "sliced", .threadCount = 1, .timeSlice = std::chrono::milliseconds { 1 } } };
+    AsyncEvent event;
+    event.signal();
+    std::atomic<bool> started = false;
+    std::atomic<bool> done = false;
+
+    auto busy = [&](RunOn) -> Sync<int> {
+        started = true;
+        int iterations = 0;
+        while (!done) {
+            auto start = std::chrono::steady_clock::now();
+            while (std::chrono::steady_clock::now() - start < std::chrono::microseconds { 100 }) { }
+            co_await event;
+            iterations++;
+        }
+        co_return iterations;
+    };
+
+    auto other = [&](RunOn) -> Sync<> {
+        done = true;
+        co_return;
+    };
+
+    auto busyTask = busy(threadPool);
+    while (!started)
+        std::this_thread::yield();
+    other(threadPool).get();
+    // without the time slice the chain would run about 128 allowances of 100 iterations
+    REQUIRE(busyTask.get() < 1000);
+}
+
+TEST_CASE("ThreadPool - yield requeues behind pending work", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "yield", .threadCount = 1 } };
+    std::vector<int> order;
+
+    auto child = [&](RunOn, int i) -> Async<> {
+        order.push_back(i);
+        co_return;
+    };
+
+    auto runner = [&](RunOn pool) -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (int i = 1; i <= 3; i++)
+            tasks.push_back(child(pool, i));
+        order.push_back(0);
+        co_await yield();
+        order.push_back(4);
+        co_await yield();
+        for (auto& task : tasks)
+            co_await task;
+    };
+
+    runner(threadPool).get();
+    REQUIRE(order.size() == 5);
+    REQUIRE(order.front() == 0);
+    REQUIRE(order.back() == 4);
+}
+
+TEST_CASE("ThreadPool - blocking calls hand their worker to a spare thread", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "blocking", .threadCount = 1 } };
+    AsyncEvent blocked;
+    std::atomic<bool> release = false;
+
+    auto blocker = [&](RunOn) -> Async<int> {
+        auto value = co_await runBlocking([&] {
+            blocked.signal();
+            while (!release)
+                std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+            return 7;
+        });
+        co_return value;
+    };
+
+    auto other = [&](RunOn) -> Async<> {
+        release = true;
+        co_return;
+    };
+
+    auto thrower = [&](RunOn) -> Async<> {
+        co_await runBlocking([] { throw std::runtime_error { "blocking" }; });
+    };
+
+    auto runner = [&](RunOn pool) -> Sync<> {
+        auto blockerTask = blocker(pool);
+        co_await blocked;
+        // the only worker is blocked, a spare runs this task
+        co_await other(pool);
+        REQUIRE(co_await blockerTask == 7);
+        REQUIRE(ThreadPool::currentThreadPool() == &pool.threadPool());
+        REQUIRE_THROWS_AS(co_await thrower(pool), std::runtime_error);
+    };
+    runner(threadPool).get();
+}
+
+TEST_CASE("ThreadPool - blocking calls keep their worker past the spare limit", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "no spares", .threadCount = 2, .maxSpareThreadCount = 0 } };
+    AsyncEvent blocked;
+    std::atomic<bool> release = false;
+
+    auto blocker = [&](RunOn) -> Async<int> {
+        auto value = co_await runBlocking([&] {
+            blocked.signal();
+            while (!release)
+                std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+            return 7;
+        });
+        co_return value;
+    };
+
+    auto other = [&](RunOn) -> Async<> {
+        release = true;
+        co_return;
+    };
+
+    auto runner = [&](RunOn pool) -> Sync<> {
+        auto blockerTask = blocker(pool);
+        co_await blocked;
+        // the blocked worker kept its slot, the other worker runs this task
+        co_await other(pool);
+        auto value = co_await blockerTask;
+        REQUIRE(value == 7);
+        REQUIRE(ThreadPool::currentThreadPool() == &pool.threadPool());
+    };
+    runner(threadPool).get();
+    REQUIRE(threadPool.startedThreadCount() == 2);
+}
+
+TEST_CASE("ThreadPool - resize a live pool", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "resize", .threadCount = 2, .maxThreadCount = 4 } };
+    REQUIRE(threadPool.threadCount() == 2);
+    REQUIRE(threadPool.maxThreadCount() == 4);
+    std::atomic<int> value = 0;
+
+    auto child = [&](RunOn) -> Async<> {
+        AsyncTestUtils::randomSpinWait(100);
+        value++;
+        co_return;
+    };
+
+    auto runner = [&](RunOn pool) -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (int i = 0; i < 100; i++)
+            tasks.push_back(child(pool));
+        for (auto& task : tasks)
+            co_await task;
+    };
+
+    for (int threadCount : { 4, 1, 8, 0, 3 }) {
+        threadPool.resize(threadCount);
+        runner(threadPool).get();
+    }
+    REQUIRE(value == 500);
+    REQUIRE(threadPool.threadCount() == 3);
+    while (threadPool.sleepingThreadCount() < threadPool.threadCount())
+        std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+}
+
+TEST_CASE("ThreadPool - lazy pools start workers on demand", "[ThreadPool]")
+{
+    constexpr size_t stackSize = 4 * 1024 * 1024;
+    ThreadPool threadPool { ThreadPoolOptions {
+        .name = "lazy", .threadCount = 4, .lazyStart = true, .stackSize = stackSize } };
+    REQUIRE(threadPool.startedThreadCount() == 0);
+    REQUIRE(threadPool.sleepingThreadCount() == 4);
+    std::atomic<int> value = 0;
+    std::atomic<size_t> minStackSize = SIZE_MAX;
+
+    auto child = [&](RunOn) -> Async<> {
+#if defined(__linux__)
+        pthread_attr_t attributes;
+        if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+            size_t size = 0;
+            pthread_attr_getstacksize(&attributes, &size);
+            pthread_attr_destroy(&attributes);
+            auto current = minStackSize.load();
+            while (size < current && !minStackSize.compare_exchange_weak(current, size)) { }
+        }
+#endif
+        AsyncTestUtils::randomSpinWait(100);
+        value++;
+        co_return;
+    };
+
+    auto runner = [&](RunOn pool) -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (int i = 0; i < 100; i++)
+            tasks.push_back(child(pool));
+        for (auto& task : tasks)
+            co_await task;
+    };
+
+    runner(threadPool).get();
+    REQUIRE(value == 100);
+    REQUIRE(threadPool.startedThreadCount() >= 1);
+    REQUIRE(threadPool.startedThreadCount() <= 4);
+#if defined(__linux__)
+    REQUIRE(minStackSize >= stackSize);
+#endif
+}
+
+TEST_CASE("ThreadPool - auto scaling follows the load", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions {
+        .name = "scaled", .threadCount = 1, .maxThreadCount = 4, .autoScale = true } };
+    std::atomic<bool> done = false;
+    std::atomic<int> maxThreadCount = 1;
+
+    auto child = [&](RunOn) -> Async<> {
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::microseconds { 200 }) { }
+        maxThreadCount = std::max(maxThreadCount.load(), ThreadPool::currentThreadPool()->threadCount());
+        co_return;
+    };
+
+    auto runner = [&](RunOn pool) -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (int i = 0; i < 2000; i++)
+            tasks.push_back(child(pool));
+        for (auto& task : tasks)
+            co_await task;
+    };
+
+    runner(threadPool).get();
+    REQUIRE(maxThreadCount > 1);
+
+    auto start = std::chrono::steady_clock::now();
+    while (threadPool.threadCount() > 1 && std::chrono::steady_clock::now() - start < std::chrono::seconds { 10 })
+        std::this_thread::sleep_for(std::chrono::milliseconds { 10 });
+    REQUIRE(threadPool.threadCount() == 1);
+}
+
+TEST_CASE("ThreadPool - long running coroutines migrate", "[ThreadPool]")
+{
+    ThreadPool heavyThreadPool { ThreadPoolOptions { .name = "heavy", .threadCount = 1 } };
+    ThreadPool threadPool { ThreadPoolOptions { .name = "light",
+        .threadCount = 1,
+        .migrationPool = &heavyThreadPool,
+        .migrationThreshold = std::chrono::milliseconds { 1 } } };
+
+    auto spin = [](std::chrono::microseconds duration) {
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < duration) { }
+    };
+
+    auto heavy = [&]() -> Async<ThreadPool*> {
+        for (int i = 0; i < 5; i++) {
+            spin(std::chrono::milliseconds { 2 });
+            co_await yield();
+        }
+        co_return ThreadPool::currentThreadPool();
+    };
+
+    // placed explicitly, stays however long it runs
+    auto pinnedHeavy = [&](RunOn) -> Async<ThreadPool*> {
+        for (int i = 0; i < 5; i++) {
+            spin(std::chrono::milliseconds { 2 });
+            co_await yield();
+        }
+        co_return ThreadPool::currentThreadPool();
+    };
+
+    auto light = [&]() -> Async<ThreadPool*> {
+        for (int i = 0; i < 5; i++)
+            co_await yield();
+        co_return ThreadPool::currentThreadPool();
+    };
+
+    auto runner = [&](RunOn pool) -> Sync<bool> {
+        auto* heavyPool = co_await heavy();
+        auto* pinnedHeavyPool = co_await pinnedHeavy(pool);
+        auto* lightPool = co_await light();
+        co_return heavyPool == &heavyThreadPool && pinnedHeavyPool == &pool.threadPool()
+            && lightPool == &pool.threadPool();
+    };
+    REQUIRE(runner(threadPool).get());
+
+    // the inline worker of blockOn keeps its task
+    auto callerId = std::this_thread::get_id();
+    auto blocking = [&]() -> Sync<int> {
+        int onCallerCount = 0;
+        for (int i = 0; i < 5; i++) {
+            spin(std::chrono::milliseconds { 2 });
+            co_await yield();
+            if (std::this_thread::get_id() == callerId)
+                onCallerCount++;
+        }
+        co_return onCallerCount;
+    };
+    REQUIRE(blockOn(blocking, threadPool) == 5);
+}
+
+TEST_CASE("ThreadPool - resume on moves a coroutine between pools", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "home", .threadCount = 2 } };
+    ThreadPool otherThreadPool { ThreadPoolOptions { .name = "other", .threadCount = 2 } };
+
+    auto runner = [&](RunOn pool) -> Sync<bool> {
+        auto* startPool = ThreadPool::currentThreadPool();
+        co_await resumeOn(otherThreadPool);
+        auto* movedPool = ThreadPool::currentThreadPool();
+        co_await resumeOn(otherThreadPool);
+        auto* stayedPool = ThreadPool::currentThreadPool();
+        ThreadPool* scopedPool;
+        {
+            auto scope = co_await scopedResumeOn(pool.threadPool());
+            scopedPool = ThreadPool::currentThreadPool();
+        }
+        // the next await point takes the coroutine back
+        co_await yield();
+        auto* restoredPool = ThreadPool::currentThreadPool();
+        auto* homePool = &pool.threadPool();
+        co_return startPool == homePool && movedPool == &otherThreadPool && stayedPool == &otherThreadPool
+            && scopedPool == homePool && restoredPool == &otherThreadPool;
+    };
+    REQUIRE(runner(threadPool).get());
+}
+
+TEST_CASE("ThreadPool - block on runs the task on the calling thread", "[ThreadPool]")
+{
+    auto callerId = std::this_thread::get_id();
+    std::atomic<int> inlineCount = 0;
+
+    auto child = [&](int i) -> Async<int> {
+        if (std::this_thread::get_id() == callerId)
+            inlineCount++;
+        co_return i;
+    };
+
+    auto parent = [&]() -> Sync<int> {
+        if (std::this_thread::get_id() == callerId)
+            inlineCount++;
+        int sum = 0;
+        for (int i = 0; i < 10; i++)
+            sum += co_await child(i);
+        co_return sum;
+    };
+
+    REQUIRE(blockOn(parent) == 45);
+    REQUIRE(inlineCount > 0);
+    REQUIRE(!ThreadPool::currentThreadPool());
+
+    AsyncEvent event;
+    auto waiter = [&]() -> Sync<int> {
+        co_await event;
+        co_return 1;
+    };
+    std::thread signaler { [&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds { 5 });
+        event.signal();
+    } };
+    REQUIRE(blockOn(waiter) == 1);
+    signaler.join();
+}
+
+TEST_CASE("ThreadPool - block on shares fan-out with the pool's workers", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "block-on", .threadCount = 2 } };
+    auto callerId = std::this_thread::get_id();
+    std::atomic<int> callerCount = 0;
+    std::atomic<int> workerCount = 0;
+
+    auto child = [&]() -> Async<> {
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::microseconds { 50 }) { }
+        if (std::this_thread::get_id() == callerId)
+            callerCount++;
+        else
+            workerCount++;
+        co_return;
+    };
+
+    auto parent = [&]() -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (int i = 0; i < 200; i++)
+            tasks.push_back(child());
+        for (auto& task : tasks)
+            co_await task;
+    };
+
+    blockOn(parent, threadPool);
+    REQUIRE(callerCount + workerCount == 200);
+    REQUIRE(callerCount > 0);
+    // workers stole from the calling thread's queue
+    REQUIRE(workerCount > 0);
+}
+
+TEST_CASE("ThreadPool - external threads join as guest workers", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "guest", .threadCount = 2 } };
+    std::atomic<int> guestCount = 0;
+    std::atomic<int> workerCount = 0;
+
+    std::thread guestThread { [&] {
+        auto guestId = std::this_thread::get_id();
+        auto child = [&](RunOn) -> Async<> {
+            auto start = std::chrono::steady_clock::now();
+            while (std::chrono::steady_clock::now() - start < std::chrono::microseconds { 50 }) { }
+            if (std::this_thread::get_id() == guestId)
+                guestCount++;
+            else
+                workerCount++;
+            co_return;
+        };
+
+        auto runner = [&](RunOn pool) -> Sync<> {
+            std::vector<Async<>> tasks;
+            for (int i = 0; i < 200; i++)
+                tasks.push_back(child(pool));
+            for (auto& task : tasks)
+                co_await task;
+        };
+
+        GuestWorker guest { threadPool };
+        auto task = runner(threadPool);
+        guest.runUntil([&task] { return task.isReady(); });
+        task.get();
+    } };
+    guestThread.join();
+
+    REQUIRE(guestCount + workerCount == 200);
+    REQUIRE(guestCount > 0);
+    // the children were scheduled on the guest's queue
+    REQUIRE(workerCount > 0);
+}
+
+TEST_CASE("ThreadPool - post runs plain callables", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "post", .threadCount = 4 } };
+    std::atomic<int> value = 0;
+    std::atomic<int> onPoolCount = 0;
+    SyncManualResetEvent done;
+
+    bool posted = true;
+    for (int i = 0; i < 1000; i++) {
+        posted = posted && post(threadPool, [&] {
+            if (ThreadPool::currentThreadPool() == &threadPool)
+                onPoolCount++;
+            // posted from a worker, lands on the same pool
+            (void)post([&] {
+                if (value.fetch_add(1) == 999)
+                    done.set();
+            });
+        });
+    }
+    done.wait();
+
+    REQUIRE(posted);
+    REQUIRE(value == 1000);
+    REQUIRE(onPoolCount == 1000);
+}
+
+TEST_CASE("ThreadPool - post runs large callables", "[ThreadPool]")
+{
+    ThreadPool threadPool { ThreadPoolOptions { .name = "post-large", .threadCount = 2 } };
+    std::atomic<int> sum = 0;
+    std::atomic<int> count = 0;
+    SyncManualResetEvent done;
+
+    std::array<int, 64> values {};
+    std::iota(values.begin(), values.end(), 1);
+    bool posted = true;
+    for (int i = 0; i < 100; i++) {
+        // too big for the inline buffer
+        posted = posted && post(threadPool, [&, values] {
+            sum += std::accumulate(values.begin(), values.end(), 0);
+            if (count.fetch_add(1) == 99)
+                done.set();
+        });
+    }
+    done.wait();
+
+    REQUIRE(posted);
+    REQUIRE(sum == 100 * 2080);
+}
+
+TEST_CASE("ThreadPool - many threads submit to a background pool", "[ThreadPool]")
+{
+    ThreadPool backgroundThreadPool { ThreadPoolOptions {
+        .name = "submit-bg", .threadCount = 4, .kind = ThreadPoolKind::Background } };
+    constexpr int submitterCount = 8;
+    constexpr int taskCount = 200;
+    std::atomic<int> value = 0;
+
+    auto child = [&](RunOn) -> Async<> {
+        value++;
+        co_return;
+    };
+
+    auto runner = [&](RunOn pool) -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (int i = 0; i < taskCount; i++)
+            tasks.push_back(child(pool));
+        for (auto& task : tasks)
+            co_await task;
+    };
+
+    std::vector<std::thread> submitters;
+    for (int i = 0; i < submitterCount; i++)
+        submitters.emplace_back([&] { runner(backgroundThreadPool).get(); });
+    for (auto& submitter : submitters)
+        submitter.join();
+    REQUIRE(value == submitterCount * taskCount);
+}
+
 TEST_CASE("ThreadPool - many tasks", "[ThreadPool]")
 {
     std::vector<Async<>> tasks;
@@ -8,48 +8,228 @@
 
 namespace Levelz::Async {
 
+namespace {
+    // std::random_device may read the kernel's entropy pool, victim selection
+    // only needs seeds that differ between workers
+    uint64_t rngSeed() noexcept
+    {
+        static std::atomic<uint64_t> s_seedCounter = 0;
+        auto seed = s_seedCounter.fetch_add(0x9e3779b97f4a7c15, std::memory_order_relaxed)
+            ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9;
+        seed = (seed ^ (seed >> 27)) * 0x94d049bb133111eb;
+        return seed ^ (seed >> 31);
+    }
+}
+
 ThreadState::ThreadState() noexcept
-    : m_localQueue {}
+    : m_localQueues {}
+    , m_deadlineQueue {}
+    , m_laneOrder { Priority::High, Priority::Normal, Priority::Low }
+    , m_laneTick { 0 }
+    , m_runNext { nullptr }
+    , m_runNextTime { 0 }
+    , m_runNextStreak { 0 }
+    , m_isRunNextPrivate { false }
+    , m_resumeCount { 0 }
+    , m_yieldedHead { nullptr }
+    , m_yieldedTail { nullptr }
     , m_isSleeping { false }
-    , m_rng { std::random_device {}() }
+    , m_wakeUpToken { WakeUpToken::None }
+    , m_isSearching { false }
+    , m_rng { static_cast<std::default_random_engine::result_type>(rngSeed()) }
     , m_threadIndex { -1 }
     , m_chainedExecutionAllowance { s_maxChainedExecutionAllowance }
+    , m_turnEnd { std::chrono::steady_clock::time_point::max() }
+    , m_isTurnOver { false }
+    , m_cpu { -1 }
 {
 }
 
-bool ThreadState::wakeUpIfSleeping()
+// Returns false if the thread is awake or another waker already woke it up
+bool ThreadState::wakeUpIfSleeping(WakeUpToken token) noexcept
 {
+    assert(token != WakeUpToken::None);
     if (!m_isSleeping)
         return false;
-    m_wakeUpEvent.set();
+    auto expected = WakeUpToken::None;
+    if (!m_wakeUpToken.compare_exchange_strong(expected, token, std::memory_order_release))
+        return false;
+    m_wakeUpToken.notify_one();
     return true;
 }
 
-bool ThreadState::tryWakeUpIfSleeping() noexcept
+ThreadState::WakeUpToken ThreadState::sleepUntilWoken() noexcept
 {
-    if (!m_isSleeping)
-        return false;
-    return m_wakeUpEvent.trySet();
+    while (true) {
+        auto token = takeWakeUpToken();
+        if (token != WakeUpToken::None)
+            return token;
+        m_wakeUpToken.wait(WakeUpToken::None, std::memory_order_relaxed);
+    }
 }
 
-void ThreadState::sleepUntilWoken()
+ThreadState::WakeUpToken ThreadState::takeWakeUpToken() noexcept
 {
-    m_wakeUpEvent.wait();
+    return m_wakeUpToken.exchange(WakeUpToken::None, std::memory_order_acquire);
 }
 
 bool ThreadState::haveLocalWork() const noexcept
 {
-    return !m_localQueue.isEmpty();
+    if (m_runNext.load(std::memory_order_relaxed) || m_yieldedHead.load(std::memory_order_relaxed)
+        || !m_deadlineQueue.isEmpty())
+        return true;
+    for (const auto& localQueue : m_localQueues) {
+        if (!localQueue.isEmpty())
+            return true;
+    }
+    return false;
 }
 
 void ThreadState::localEnqueue(Coroutine* scheduleOperation) noexcept
 {
-    m_localQueue.enqueue(scheduleOperation);
+    if (scheduleOperation->hasDeadline())
+        m_deadlineQueue.enqueue(scheduleOperation);
+    else
+        m_localQueues[lane(scheduleOperation)].push(scheduleOperation);
+}
+
+void ThreadState::localEnqueueChain(Coroutine* first, uint64_t count) noexcept
+{
+    // chains are built per priority, and apart for coroutines with a deadline
+    if (first->hasDeadline())
+        m_deadlineQueue.enqueueChain(first, count);
+    else
+        m_localQueues[lane(first)].pushChain(first, count);
+}
+
+void ThreadState::runNextEnqueue(Coroutine* scheduleOperation) noexcept
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    m_runNextTime.store(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(), std::memory_order_relaxed);
+    auto* previous = m_runNext.exchange(scheduleOperation, std::memory_order_acq_rel);
+    if (previous)
+        localEnqueue(previous);
 }
 
 Coroutine* ThreadState::tryLocalPop() noexcept
 {
-    return m_localQueue.dequeue();
+    // a ping-pong pair could keep the run next slot busy forever, so after a
+    // streak of run next coroutines the local queues get a turn
+    if (m_runNextStreak < s_maxRunNextStreak) {
+        auto* coroutine = tryTakeRunNext();
+        if (coroutine) {
+            m_runNextStreak++;
+            return coroutine;
+        }
+    }
+
+    m_runNextStreak = 0;
+    for (auto priority : m_laneOrder) {
+        auto* coroutine = m_localQueues[static_cast<int>(priority)].pop();
+        if (coroutine)
+            return coroutine;
+    }
+    return tryTakeRunNext();
+}
+
+Coroutine* ThreadState::tryDeadlinePop() noexcept
+{
+    return m_deadlineQueue.dequeue();
+}
+
+std::chrono::steady_clock::time_point ThreadState::earliestDeadline() const noexcept
+{
+    return m_deadlineQueue.earliestDeadline();
+}
+
+Coroutine* ThreadState::tryTakeRunNext() noexcept
+{
+    if (!m_runNext.load(std::memory_order_relaxed))
+        return nullptr;
+    return m_runNext.exchange(nullptr, std::memory_order_acquire);
+}
+
+void ThreadState::yieldedEnqueue(Coroutine* scheduleOperation) noexcept
+{
+    scheduleOperation->setNext(nullptr);
+    if (m_yieldedTail)
+        m_yieldedTail->setNext(scheduleOperation);
+    else
+        m_yieldedHead.store(scheduleOperation, std::memory_order_relaxed);
+    m_yieldedTail = scheduleOperation;
+}
+
+Coroutine* ThreadState::tryTakeYielded() noexcept
+{
+    auto* coroutine = m_yieldedHead.load(std::memory_order_relaxed);
+    if (!coroutine)
+        return nullptr;
+    m_yieldedHead.store(coroutine->next(), std::memory_order_relaxed);
+    if (!coroutine->next())
+        m_yieldedTail = nullptr;
+    coroutine->setNext(nullptr);
+    return coroutine;
+}
+
+Coroutine* ThreadState::tryStealHalf(ThreadState& thiefState) noexcept
+{
+    assert(&thiefState != this);
+    // deadline work is the most urgent, a thief takes the earliest alone
+    if (auto* coroutine = m_deadlineQueue.dequeue())
+        return coroutine;
+    for (size_t i = 0; i < m_localQueues.size(); ++i) {
+        auto* coroutine = m_localQueues[i].stealHalf(thiefState.m_localQueues[i], s_maxStealCount);
+        if (coroutine)
+            return coroutine;
+    }
+    return tryStealRunNext();
+}
+
+Coroutine* ThreadState::tryStealRunNext() noexcept
+{
+    auto* coroutine = m_runNext.load(std::memory_order_acquire);
+    if (!coroutine || m_isRunNextPrivate.load(std::memory_order_relaxed))
+        return nullptr;
+
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    auto age = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()
+        - m_runNextTime.load(std::memory_order_relaxed);
+    if (age < s_runNextStealDelay.count())
+        return nullptr;
+
+    if (!m_runNext.compare_exchange_strong(coroutine, nullptr, std::memory_order_acquire))
+        return nullptr;
+    return coroutine;
+}
+
+void ThreadState::setRunNextPrivate(bool isPrivate) noexcept
+{
+    m_isRunNextPrivate.store(isPrivate, std::memory_order_relaxed);
+}
+
+// Higher lanes go first, but every s_normalLaneInterval-th pick starts with the
+// normal lane and every s_lowLaneInterval-th with the low lane, which bounds how
+// long lower lanes can starve.
+void ThreadState::advanceLaneOrder() noexcept
+{
+    ++m_laneTick;
+    if (m_laneTick % s_lowLaneInterval == 0)
+        m_laneOrder = { Priority::Low, Priority::High, Priority::Normal };
+    else if (m_laneTick % s_normalLaneInterval == 0)
+        m_laneOrder = { Priority::Normal, Priority::High, Priority::Low };
+    else
+        m_laneOrder = { Priority::High, Priority::Normal, Priority::Low };
+}
+
+const std::array<Priority, 3>& ThreadState::laneOrder() const noexcept
+{
+    return m_laneOrder;
+}
+
+int ThreadState::lane(const Coroutine* coroutine) noexcept
+{
+    return static_cast<int>(coroutine->priority());
 }
 
 uint64_t ThreadState::rand()
@@ -67,6 +247,16 @@ bool ThreadState::isSleeping() const noexcept
     return m_isSleeping;
 }
 
+void ThreadState::setSearching(bool isSearching) noexcept
+{
+    m_isSearching = isSearching;
+}
+
+bool ThreadState::isSearching() const noexcept
+{
+    return m_isSearching;
+}
+
 int ThreadState::threadIndex() const noexcept
 {
     assert(m_threadIndex != -1);
@@ -79,6 +269,38 @@ void ThreadState::setThreadIndex(int threadIndex) noexcept
     m_threadIndex = threadIndex;
 }
 
+int ThreadState::cpu() const noexcept
+{
+    return m_cpu;
+}
+
+void ThreadState::setPlacement(int cpu, std::vector<int> cacheDomainPeers, std::vector<int> numaNodePeers)
+{
+    m_cpu = cpu;
+    m_cacheDomainPeers = std::move(cacheDomainPeers);
+    m_numaNodePeers = std::move(numaNodePeers);
+}
+
+const std::vector<int>& ThreadState::cacheDomainPeers() const noexcept
+{
+    return m_cacheDomainPeers;
+}
+
+const std::vector<int>& ThreadState::numaNodePeers() const noexcept
+{
+    return m_numaNodePeers;
+}
+
+void ThreadState::recordResume() noexcept
+{
+    m_resumeCount.store(m_resumeCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+uint64_t ThreadState::resumeCount() const noexcept
+{
+    return m_resumeCount.load(std::memory_order_relaxed);
+}
+
 int ThreadState::chainedExecutionAllowance() const noexcept
 {
     return m_chainedExecutionAllowance;
@@ -95,4 +317,33 @@ void ThreadState::recordChainedExecution() noexcept
     m_chainedExecutionAllowance--;
 }
 
+void ThreadState::setTurnEnd(std::chrono::steady_clock::time_point turnEnd) noexcept
+{
+    m_turnEnd = turnEnd;
+}
+
+std::chrono::steady_clock::time_point ThreadState::turnEnd() const noexcept
+{
+    return m_turnEnd;
+}
+
+// Once the time slice is spent it stays spent until the next resumption, and
+// the worker remembers to look at remote work first.
+bool ThreadState::checkTurnOver() noexcept
+{
+    if (m_isTurnOver)
+        return true;
+    if (m_turnEnd == std::chrono::steady_clock::time_point::max() || std::chrono::steady_clock::now() < m_turnEnd)
+        return false;
+    m_isTurnOver = true;
+    return true;
+}
+
+bool ThreadState::takeTurnOver() noexcept
+{
+    auto isTurnOver = m_isTurnOver;
+    m_isTurnOver = false;
+    return isTurnOver;
+}
+
 }
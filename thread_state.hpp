@@ -5,15 +5,19 @@
 #ifndef LEVELZ_THREAD_STATE_HPP
 #define LEVELZ_THREAD_STATE_HPP
 
+#include <array>
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <mutex>
 #include <random>
 #include <thread>
+#include <vector>
 
-#include "event/sync_auto_reset_event.hpp"
 #include "coroutine.hpp"
-#include "fifo_wait_list.hpp"
+#include "deadline_queue.hpp"
+#include "priority.hpp"
+#include "work_stealing_deque.hpp"
 
 namespace Levelz::Async {
 
@@ -23,30 +27,94 @@ struct ThreadState {
 private:
     friend struct ThreadPool;
 
-    bool wakeUpIfSleeping();
-    [[nodiscard]] bool tryWakeUpIfSleeping() noexcept;
-    void sleepUntilWoken();
+    enum class WakeUpToken : uint32_t {
+        None,
+        WakeUp,
+        // hands over the waker's slot in the pool's searching thread count
+        Search
+    };
+
+    [[nodiscard]] bool wakeUpIfSleeping(WakeUpToken token) noexcept;
+    WakeUpToken sleepUntilWoken() noexcept;
+    WakeUpToken takeWakeUpToken() noexcept;
     bool haveLocalWork() const noexcept;
     void localEnqueue(Coroutine* operation) noexcept;
+    void runNextEnqueue(Coroutine* operation) noexcept;
+    void localEnqueueChain(Coroutine* first, uint64_t count) noexcept;
     Coroutine* tryLocalPop() noexcept;
+    Coroutine* tryDeadlinePop() noexcept;
+    std::chrono::steady_clock::time_point earliestDeadline() const noexcept;
+    Coroutine* tryTakeRunNext() noexcept;
+    void yieldedEnqueue(Coroutine* operation) noexcept;
+    Coroutine* tryTakeYielded() noexcept;
+    Coroutine* tryStealHalf(ThreadState& thiefState) noexcept;
+    Coroutine* tryStealRunNext() noexcept;
+    void setRunNextPrivate(bool isPrivate) noexcept;
+    void advanceLaneOrder() noexcept;
+    const std::array<Priority, 3>& laneOrder() const noexcept;
+    static int lane(const Coroutine* coroutine) noexcept;
     uint64_t rand();
     void setSleeping(bool isSleeping) noexcept;
     bool isSleeping() const noexcept;
+    void setSearching(bool isSearching) noexcept;
+    bool isSearching() const noexcept;
     int threadIndex() const noexcept;
     void setThreadIndex(int threadIndex) noexcept;
+    int cpu() const noexcept;
+    void setPlacement(int cpu, std::vector<int> cacheDomainPeers, std::vector<int> numaNodePeers);
+    const std::vector<int>& cacheDomainPeers() const noexcept;
+    const std::vector<int>& numaNodePeers() const noexcept;
 
+    void recordResume() noexcept;
+    uint64_t resumeCount() const noexcept;
     int chainedExecutionAllowance() const noexcept;
     void setChainedExecutionAllowance(int count) noexcept;
     void recordChainedExecution() noexcept;
+    void setTurnEnd(std::chrono::steady_clock::time_point turnEnd) noexcept;
+    std::chrono::steady_clock::time_point turnEnd() const noexcept;
+    bool checkTurnOver() noexcept;
+    bool takeTurnOver() noexcept;
 
     int m_threadIndex {};
-    FifoWaitList m_localQueue;
+    // one queue per priority lane, indexed by Priority
+    std::array<WorkStealingDeque<Coroutine>, 3> m_localQueues;
+    // coroutines with a deadline bypass the lanes and run earliest deadline
+    // first; thieves take the earliest too
+    DeadlineQueue m_deadlineQueue;
+    std::array<Priority, 3> m_laneOrder;
+    uint64_t m_laneTick;
+    // most recently woken coroutine, runs right after the current one while its data is hot
+    std::atomic<Coroutine*> m_runNext;
+    std::atomic<int64_t> m_runNextTime;
+    int m_runNextStreak;
+    // set while a guest runs coroutines, its run next coroutine is then never stolen
+    std::atomic<bool> m_isRunNextPrivate;
+    // written by the owner only, read by the pool's scaling controller
+    std::atomic<uint64_t> m_resumeCount;
+    // coroutines that yielded, run in order once other work is done; owner only,
+    // the head is atomic so other threads can see whether it is empty
+    std::atomic<Coroutine*> m_yieldedHead;
+    Coroutine* m_yieldedTail;
     std::atomic<bool> m_isSleeping;
-    SyncAutoResetEvent m_wakeUpEvent;
+    // futex style wake up token, set by wakers and consumed by the sleeping worker
+    std::atomic<WakeUpToken> m_wakeUpToken;
+    bool m_isSearching;
     std::default_random_engine m_rng;
     int m_chainedExecutionAllowance;
+    // end of the current resumption's time slice, checked at await points
+    std::chrono::steady_clock::time_point m_turnEnd;
+    bool m_isTurnOver;
+    int m_cpu;
+    std::vector<int> m_cacheDomainPeers;
+    std::vector<int> m_numaNodePeers;
 
     static constexpr int s_maxChainedExecutionAllowance = 100;
+    static constexpr uint64_t s_maxStealCount = 64;
+    static constexpr int s_maxRunNextStreak = 16;
+    static constexpr uint64_t s_normalLaneInterval = 8;
+    static constexpr uint64_t s_lowLaneInterval = 64;
+    // the owner is expected to run its run next coroutine soon, thieves leave it alone this long
+    static constexpr std::chrono::nanoseconds s_runNextStealDelay = std::chrono::microseconds { 5 };
 };
 
 }
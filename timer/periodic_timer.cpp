@@ -0,0 +1,34 @@
+#include <cassert>
+
+#include "periodic_timer.hpp"
+
+namespace Levelz::Async {
+
+PeriodicTimer::PeriodicTimer(std::chrono::nanoseconds period) noexcept
+    : PeriodicTimer { period, std::chrono::steady_clock::now() }
+{
+}
+
+PeriodicTimer::PeriodicTimer(std::chrono::nanoseconds period, std::chrono::steady_clock::time_point start) noexcept
+    : m_period { period }
+    , m_nextDeadline { start + period }
+{
+    assert(period.count() > 0);
+}
+
+std::chrono::steady_clock::time_point PeriodicTimer::nextDeadline() noexcept
+{
+    auto deadline = m_nextDeadline;
+    auto now = std::chrono::steady_clock::now();
+    if (deadline < now)
+        deadline += ((now - deadline) / m_period) * m_period;
+    m_nextDeadline = deadline + m_period;
+    return deadline;
+}
+
+std::chrono::nanoseconds PeriodicTimer::period() const noexcept
+{
+    return m_period;
+}
+
+}
@@ -0,0 +1,24 @@
+#ifndef LEVELZ_PERIODIC_TIMER_HPP
+#define LEVELZ_PERIODIC_TIMER_HPP
+
+#include <chrono>
+
+namespace Levelz::Async {
+
+// Each co_await completes at the next multiple of the period after start.
+// Ticks missed by a slow consumer are skipped, not delivered in a burst.
+struct PeriodicTimer {
+    explicit PeriodicTimer(std::chrono::nanoseconds period) noexcept;
+    PeriodicTimer(std::chrono::nanoseconds period, std::chrono::steady_clock::time_point start) noexcept;
+
+    std::chrono::steady_clock::time_point nextDeadline() noexcept;
+    std::chrono::nanoseconds period() const noexcept;
+
+private:
+    const std::chrono::nanoseconds m_period;
+    std::chrono::steady_clock::time_point m_nextDeadline;
+};
+
+}
+
+#endif // LEVELZ_PERIODIC_TIMER_HPP
@@ -0,0 +1,70 @@
+#include <cassert>
+
+#include "coroutine.hpp"
+#include "sleep.hpp"
+
+namespace Levelz::Async {
+
+Sleep sleepFor(std::chrono::nanoseconds duration) noexcept
+{
+    return Sleep { .deadline = std::chrono::steady_clock::now() + duration };
+}
+
+Sleep sleepUntil(std::chrono::steady_clock::time_point deadline) noexcept
+{
+    return Sleep { .deadline = deadline };
+}
+
+SleepAwaiter::SleepAwaiter(std::chrono::steady_clock::time_point deadline, Coroutine& coroutine) noexcept
+    : Awaiter { coroutine, AwaiterKind::Timer }
+    , m_deadline { deadline }
+    , m_timer { coroutine }
+{
+}
+
+bool SleepAwaiter::await_ready() noexcept
+{
+    auto suspensionAdvice = Awaiter::onReady();
+    if (suspensionAdvice == Awaiter::SuspensionAdvice::shouldNotSuspend)
+        return true;
+    if (suspensionAdvice == Awaiter::SuspensionAdvice::shouldSuspend)
+        return false;
+
+    return m_deadline <= std::chrono::steady_clock::now();
+}
+
+bool SleepAwaiter::await_suspend(std::coroutine_handle<> awaitingCoroutineHandle) noexcept
+{
+    auto suspensionAdvice = Awaiter::onSuspend(awaitingCoroutineHandle);
+    if (suspensionAdvice == Awaiter::SuspensionAdvice::shouldNotSuspend)
+        return false;
+
+    setMaybeBlocked(true);
+    auto isArmed = TimerService::instance().arm(m_timer, m_deadline);
+    setMaybeBlocked(isArmed);
+    if (suspensionAdvice == Awaiter::SuspensionAdvice::shouldSuspend) {
+        if (!isArmed)
+            coroutine().schedule();
+        return true;
+    }
+
+    return isArmed;
+}
+
+void SleepAwaiter::await_resume()
+{
+    Awaiter::onResume();
+}
+
+bool SleepAwaiter::cancel() noexcept
+{
+    auto& coroutine = Awaiter::coroutine();
+    assert(coroutine.isCancelled() || isTimedOut());
+    assert(coroutine.status() == CoroutineStatus::PauseOnRunning || coroutine.status() == CoroutineStatus::Paused);
+    auto disarmed = TimerService::instance().disarm(m_timer);
+    if (disarmed)
+        coroutine.schedule();
+    return disarmed;
+}
+
+}
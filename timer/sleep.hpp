@@ -0,0 +1,40 @@
+#ifndef LEVELZ_SLEEP_HPP
+#define LEVELZ_SLEEP_HPP
+
+#include <chrono>
+#include <coroutine>
+
+#include "awaiter.hpp"
+#include "timer_service.hpp"
+
+namespace Levelz::Async {
+
+// co_await sleepFor(duration) suspends the coroutine without blocking its thread
+struct Sleep {
+    std::chrono::steady_clock::time_point deadline;
+};
+
+Sleep sleepFor(std::chrono::nanoseconds duration) noexcept;
+Sleep sleepUntil(std::chrono::steady_clock::time_point deadline) noexcept;
+
+struct SleepAwaiter : Awaiter {
+    SleepAwaiter(std::chrono::steady_clock::time_point deadline, Coroutine& coroutine) noexcept;
+
+    SleepAwaiter(const SleepAwaiter&) = delete;
+    SleepAwaiter& operator=(const SleepAwaiter&) = delete;
+    SleepAwaiter(SleepAwaiter&&) = delete;
+    SleepAwaiter& operator=(SleepAwaiter&&) = delete;
+
+    bool await_ready() noexcept;
+    bool await_suspend(std::coroutine_handle<> awaitingCoroutineHandle) noexcept;
+    void await_resume();
+    bool cancel() noexcept;
+
+private:
+    const std::chrono::steady_clock::time_point m_deadline;
+    CoroutineTimer m_timer;
+};
+
+}
+
+#endif // LEVELZ_SLEEP_HPP
@@ -0,0 +1,88 @@
+#ifndef LEVELZ_TIMEOUT_HPP
+#define LEVELZ_TIMEOUT_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <utility>
+
+#include "awaiter.hpp"
+#include "timeout_error.hpp"
+#include "timer_service.hpp"
+
+namespace Levelz::Async {
+
+// co_await withTimeout(awaitable, duration) throws TimeoutError if the wait
+// outlasts the deadline. The coroutine itself is not cancelled.
+template <typename Awaitable>
+struct Timeout {
+    Awaitable&& awaitable;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+template <typename Awaitable>
+Timeout<Awaitable> withTimeout(Awaitable&& awaitable, std::chrono::steady_clock::time_point deadline) noexcept
+{
+    return { std::forward<Awaitable>(awaitable), deadline };
+}
+
+template <typename Awaitable>
+Timeout<Awaitable> withTimeout(Awaitable&& awaitable, std::chrono::nanoseconds duration) noexcept
+{
+    return { std::forward<Awaitable>(awaitable), std::chrono::steady_clock::now() + duration };
+}
+
+// Wraps the awaiter of the timed awaitable. When the timer fires first the
+// wait is ended through Awaiter::cancel, which takes the coroutine off the
+// awaitable's wait list.
+template <typename AwaiterType>
+struct TimeoutAwaiter {
+    template <typename MakeAwaiter>
+    TimeoutAwaiter(MakeAwaiter&& makeAwaiter, std::chrono::steady_clock::time_point deadline)
+        : m_awaiter { makeAwaiter() }
+        , m_timer { m_awaiter.coroutine(), &m_awaiter }
+        , m_deadline { deadline }
+        , m_isArmed { false }
+    {
+    }
+
+    TimeoutAwaiter(const TimeoutAwaiter&) = delete;
+    TimeoutAwaiter& operator=(const TimeoutAwaiter&) = delete;
+    TimeoutAwaiter(TimeoutAwaiter&&) = delete;
+    TimeoutAwaiter& operator=(TimeoutAwaiter&&) = delete;
+
+    bool await_ready() noexcept
+    {
+        return m_awaiter.await_ready();
+    }
+
+    auto await_suspend(std::coroutine_handle<> awaitingCoroutineHandle) noexcept
+    {
+        // armed before the wait starts, once it does the coroutine may be
+        // resumed elsewhere and this awaiter gone
+        auto earliest = std::chrono::steady_clock::now() + TimerService::s_tickDuration;
+        m_isArmed = TimerService::instance().arm(m_timer, std::max(m_deadline, earliest));
+        return m_awaiter.await_suspend(awaitingCoroutineHandle);
+    }
+
+    decltype(auto) await_resume()
+    {
+        if (m_isArmed)
+            TimerService::instance().disarm(m_timer);
+        if (m_awaiter.isTimedOut()) {
+            m_awaiter.Awaiter::onResume();
+            throw TimeoutError {};
+        }
+        return m_awaiter.await_resume();
+    }
+
+private:
+    AwaiterType m_awaiter;
+    CoroutineTimer m_timer;
+    const std::chrono::steady_clock::time_point m_deadline;
+    bool m_isArmed;
+};
+
+}
+
+#endif // LEVELZ_TIMEOUT_HPP
@@ -0,0 +1,17 @@
+#ifndef LEVELZ_TIMEOUT_ERROR_HPP
+#define LEVELZ_TIMEOUT_ERROR_HPP
+
+#include <stdexcept>
+
+namespace Levelz::Async {
+
+struct TimeoutError : std::runtime_error {
+    TimeoutError()
+        : std::runtime_error("timeout error")
+    {
+    }
+};
+
+}
+
+#endif // LEVELZ_TIMEOUT_ERROR_HPP
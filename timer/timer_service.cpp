@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "awaiter.hpp"
+#include "coroutine.hpp"
+#include "schedule_batch.hpp"
+#include "timer_service.hpp"
+
+namespace Levelz::Async {
+
+thread_local bool TimerService::s_isTimingOut = false;
+
+CoroutineTimer::CoroutineTimer(Coroutine& coroutine, Awaiter* timedAwaiter) noexcept
+    : m_coroutine { coroutine }
+    , m_timedAwaiter { timedAwaiter }
+    , m_action { timedAwaiter ? TimerAction::TimeOut : TimerAction::Schedule }
+{
+}
+
+CoroutineTimer::CoroutineTimer(Coroutine& coroutine, TimerAction action) noexcept
+    : m_coroutine { coroutine }
+    , m_timedAwaiter { nullptr }
+    , m_action { action }
+{
+    assert(action != TimerAction::TimeOut);
+}
+
+Coroutine& CoroutineTimer::timerCoroutine() const noexcept
+{
+    return m_coroutine;
+}
+
+Awaiter* CoroutineTimer::timedAwaiter() const noexcept
+{
+    return m_timedAwaiter;
+}
+
+TimerAction CoroutineTimer::action() const noexcept
+{
+    return m_action;
+}
+
+TimerService::TimerService()
+    : m_epoch { std::chrono::steady_clock::now() }
+    , m_mutex {}
+    , m_cv {}
+    , m_wheel { 0 }
+    , m_wakeUpTick { std::numeric_limits<uint64_t>::max() }
+    , m_stopRequested { false }
+    , m_thread {}
+{
+    m_thread = std::thread { [this] { run(); } };
+}
+
+TimerService::~TimerService()
+{
+    {
+        std::unique_lock lock { m_mutex };
+        m_stopRequested = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+}
+
+// Created on first use, which is from a coroutine running on a thread pool, so
+// it is destroyed before the pools it schedules on.
+TimerService& TimerService::instance() noexcept
+{
+    static TimerService s_timerService;
+    return s_timerService;
+}
+
+bool TimerService::arm(CoroutineTimer& timer, std::chrono::steady_clock::time_point deadline) noexcept
+{
+    if (deadline <= std::chrono::steady_clock::now())
+        return false;
+
+    // rounded up so timers never fire early
+    auto tick = toTick(deadline + s_tickDuration - std::chrono::nanoseconds { 1 });
+    bool wakeUp;
+    {
+        std::unique_lock lock { m_mutex };
+        tick = std::max(tick, m_wheel.currentTick() + 1);
+        timer.setExpiryTick(tick);
+        auto inserted = m_wheel.insert(&timer);
+        assert(inserted);
+        (void)inserted;
+        wakeUp = tick < m_wakeUpTick;
+        if (wakeUp)
+            m_wakeUpTick = tick;
+    }
+    if (wakeUp)
+        m_cv.notify_one();
+    return true;
+}
+
+bool TimerService::disarm(CoroutineTimer& timer) noexcept
+{
+    // a timeout ending a wait on another timer, run() already holds the lock
+    if (s_isTimingOut)
+        return m_wheel.remove(&timer);
+
+    std::unique_lock lock { m_mutex };
+    return m_wheel.remove(&timer);
+}
+
+void TimerService::run() noexcept
+{
+    std::unique_lock lock { m_mutex };
+    while (!m_stopRequested) {
+        auto* expired = m_wheel.advance(toTick(std::chrono::steady_clock::now()));
+        if (expired) {
+            // the coroutines are read before unlocking, once scheduled their
+            // timers may be gone
+            ScheduleBatch batch;
+            while (expired) {
+                auto* timer = static_cast<CoroutineTimer*>(expired);
+                expired = expired->next();
+                if (timer->action() == TimerAction::Schedule) {
+                    batch.add(&timer->timerCoroutine());
+                    continue;
+                }
+                if (timer->action() == TimerAction::Cancel) {
+                    // a deadline moved since arming is rearmed by the coroutine
+                    // at its next await, it cannot block without one
+                    auto& coroutine = timer->timerCoroutine();
+                    if (!coroutine.isPastDeadline())
+                        continue;
+                    // cancel passes over a wait it caught before it blocked,
+                    // later ticks end it
+                    s_isTimingOut = true;
+                    coroutine.cancel();
+                    auto isCancelled = coroutine.cancelAwaiters();
+                    s_isTimingOut = false;
+                    if (!isCancelled) {
+                        timer->setExpiryTick(m_wheel.currentTick() + 1);
+                        auto inserted = m_wheel.insert(timer);
+                        assert(inserted);
+                        (void)inserted;
+                    }
+                    continue;
+                }
+                // timeouts run under the lock, so the awaiter cannot disarm and
+                // go away meanwhile. One that caught its awaiter before it blocked
+                // tries again on the next tick.
+                s_isTimingOut = true;
+                auto isTimedOut = Awaiter::timeOut(timer->timedAwaiter());
+                s_isTimingOut = false;
+                if (!isTimedOut) {
+                    timer->setExpiryTick(m_wheel.currentTick() + 1);
+                    auto inserted = m_wheel.insert(timer);
+                    assert(inserted);
+                    (void)inserted;
+                }
+            }
+            lock.unlock();
+            batch.schedule();
+            lock.lock();
+            continue;
+        }
+
+        m_wakeUpTick = m_wheel.nextEventTick();
+        if (m_wakeUpTick == std::numeric_limits<uint64_t>::max())
+            m_cv.wait(lock);
+        else
+            m_cv.wait_until(lock, toTimePoint(m_wakeUpTick));
+    }
+}
+
+uint64_t TimerService::toTick(std::chrono::steady_clock::time_point timePoint) const noexcept
+{
+    if (timePoint <= m_epoch)
+        return 0;
+    return static_cast<uint64_t>((timePoint - m_epoch) / s_tickDuration);
+}
+
+std::chrono::steady_clock::time_point TimerService::toTimePoint(uint64_t tick) const noexcept
+{
+    return m_epoch + tick * s_tickDuration;
+}
+
+}
@@ -0,0 +1,82 @@
+#ifndef LEVELZ_TIMER_SERVICE_HPP
+#define LEVELZ_TIMER_SERVICE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "timer_wheel.hpp"
+
+namespace Levelz::Async {
+
+struct Awaiter;
+struct Coroutine;
+
+// What a CoroutineTimer does to its coroutine when it fires
+enum class TimerAction {
+    Schedule,
+    // ends the wait of the timed awaiter
+    TimeOut,
+    // cancels the coroutine if it is past its deadline
+    Cancel
+};
+
+// Schedules its coroutine when it fires, or times out the awaiter's wait if
+// it has one
+struct CoroutineTimer : TimerNode {
+    explicit CoroutineTimer(Coroutine& coroutine, Awaiter* timedAwaiter = nullptr) noexcept;
+    CoroutineTimer(Coroutine& coroutine, TimerAction action) noexcept;
+
+    Coroutine& timerCoroutine() const noexcept;
+    Awaiter* timedAwaiter() const noexcept;
+    TimerAction action() const noexcept;
+
+private:
+    Coroutine& m_coroutine;
+    Awaiter* const m_timedAwaiter;
+    const TimerAction m_action;
+};
+
+// Owns the timer wheel and a single thread that advances it and schedules the
+// coroutines of expired timers on their thread pools.
+struct TimerService {
+    ~TimerService();
+
+    TimerService(const TimerService&) = delete;
+    TimerService(TimerService&&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+    TimerService& operator=(TimerService&&) = delete;
+
+    static TimerService& instance() noexcept;
+
+    // Returns false without arming the timer if the deadline has passed
+    [[nodiscard]] bool arm(CoroutineTimer& timer, std::chrono::steady_clock::time_point deadline) noexcept;
+    // Returns false if the timer already fired or was never armed. A firing
+    // timeout completes before disarm returns. Timeouts may disarm other
+    // timers, such as the one of the sleep they end.
+    bool disarm(CoroutineTimer& timer) noexcept;
+
+    static constexpr std::chrono::nanoseconds s_tickDuration = std::chrono::milliseconds { 1 };
+
+private:
+    TimerService();
+
+    void run() noexcept;
+    uint64_t toTick(std::chrono::steady_clock::time_point timePoint) const noexcept;
+    std::chrono::steady_clock::time_point toTimePoint(uint64_t tick) const noexcept;
+
+    const std::chrono::steady_clock::time_point m_epoch;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    TimerWheel m_wheel;
+    uint64_t m_wakeUpTick;
+    bool m_stopRequested;
+    std::thread m_thread;
+    // set on the timer thread while a timeout or cancellation runs under m_mutex
+    static thread_local bool s_isTimingOut;
+};
+
+}
+
+#endif // LEVELZ_TIMER_SERVICE_HPP
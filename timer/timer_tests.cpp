@@ -0,0 +1,338 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "event/async_barrier.hpp"
+#include "event/async_event.hpp"
+#include "event/async_mutex.hpp"
+#include "event/async_value.hpp"
+#include "task/async_task.hpp"
+#include "task/cancellation_error.hpp"
+#include "task/sync_task.hpp"
+#include "timer/periodic_timer.hpp"
+#include "timer/sleep.hpp"
+#include "timer/timeout.hpp"
+#include "timer/timer_wheel.hpp"
+
+namespace Levelz::Async::Test {
+
+namespace {
+    int expiredCount(TimerNode* expired)
+    {
+        int count = 0;
+        for (; expired; expired = expired->next())
+            count++;
+        return count;
+    }
+}
+
+TEST_CASE("TimerWheel - insert, advance and remove", "[Timer]")
+{
+    TimerWheel wheel;
+    TimerNode node1;
+    TimerNode node2;
+    TimerNode node3;
+    node1.setExpiryTick(5);
+    node2.setExpiryTick(5);
+    node3.setExpiryTick(10);
+    REQUIRE(wheel.insert(&node1));
+    REQUIRE(wheel.insert(&node2));
+    REQUIRE(wheel.insert(&node3));
+    REQUIRE(wheel.count() == 3);
+    REQUIRE(wheel.nextEventTick() == 5);
+
+    REQUIRE(wheel.remove(&node2));
+    REQUIRE_FALSE(wheel.remove(&node2));
+    REQUIRE(wheel.advance(4) == nullptr);
+
+    auto* expired = wheel.advance(7);
+    REQUIRE(expired == &node1);
+    REQUIRE(expiredCount(expired) == 1);
+    REQUIRE_FALSE(node1.isLinked());
+
+    REQUIRE(expiredCount(wheel.advance(10)) == 1);
+    REQUIRE(wheel.isEmpty());
+
+    node1.setExpiryTick(200);
+    node2.setExpiryTick(20);
+    node3.setExpiryTick(90);
+    REQUIRE(wheel.insert(&node1));
+    REQUIRE(wheel.insert(&node2));
+    REQUIRE(wheel.insert(&node3));
+    expired = wheel.advance(500);
+    REQUIRE(expired == &node2);
+    REQUIRE(expired->next() == &node3);
+    REQUIRE(expired->next()->next() == &node1);
+    REQUIRE(expired->next()->next()->next() == nullptr);
+    REQUIRE(wheel.nextEventTick() == UINT64_MAX);
+
+    TimerNode late;
+    late.setExpiryTick(3);
+    REQUIRE_FALSE(wheel.insert(&late));
+}
+
+TEST_CASE("TimerWheel - far timers cascade to their tick", "[Timer]")
+{
+    TimerWheel wheel { 100 };
+    std::vector<std::unique_ptr<TimerNode>> nodes;
+    for (uint64_t delta : { 1, 63, 64, 65, 4095, 4096, 4097, 300000, 16777215 }) {
+        nodes.push_back(std::make_unique<TimerNode>());
+        nodes.back()->setExpiryTick(100 + delta);
+        REQUIRE(wheel.insert(nodes.back().get()));
+    }
+
+    for (auto& node : nodes) {
+        auto tick = node->expiryTick();
+        REQUIRE(wheel.nextEventTick() <= tick);
+        REQUIRE(wheel.advance(tick - 1) == nullptr);
+        auto* expired = wheel.advance(tick);
+        REQUIRE(expired == node.get());
+        REQUIRE(expired->next() == nullptr);
+    }
+    REQUIRE(wheel.isEmpty());
+}
+
+TEST_CASE("Timer - sleep for a duration", "[Timer]")
+{
+    auto runner = []() -> Sync<> {
+        auto start = std::chrono::steady_clock::now();
+        co_await sleepFor(std::chrono::milliseconds { 20 });
+        REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds { 20 });
+
+        co_await sleepUntil(start);
+        co_await sleepFor(std::chrono::milliseconds { 0 });
+    };
+    runner().get();
+}
+
+TEST_CASE("Timer - many sleepers wake after their deadlines", "[Timer]")
+{
+    std::vector<int> order;
+    std::mutex mutex;
+    std::atomic<int> early = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    auto sleeper = [&](int i) -> Async<> {
+        auto deadline = start + std::chrono::milliseconds { 10 * (10 - i) };
+        co_await sleepUntil(deadline);
+        if (std::chrono::steady_clock::now() < deadline)
+            early++;
+        std::scoped_lock lock { mutex };
+        order.push_back(i);
+    };
+
+    auto runner = [&]() -> Sync<> {
+        std::vector<Async<>> tasks;
+        for (int i = 0; i < 10; i++)
+            tasks.push_back(sleeper(i));
+        for (auto& task : tasks)
+            co_await task;
+    };
+    runner().get();
+
+    REQUIRE(order.size() == 10);
+    REQUIRE(early == 0);
+    // a late timer thread may fire neighbours together, the extremes stay apart
+    REQUIRE(order.front() == 9);
+    REQUIRE(order.back() == 0);
+}
+
+TEST_CASE("Timer - periodic timer skips missed ticks", "[Timer]")
+{
+    auto runner = []() -> Sync<> {
+        auto start = std::chrono::steady_clock::now();
+        PeriodicTimer timer { std::chrono::milliseconds { 10 }, start };
+        co_await timer;
+        REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds { 10 });
+        co_await timer;
+        REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds { 20 });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds { 35 });
+        auto now = std::chrono::steady_clock::now();
+        auto deadline = timer.nextDeadline();
+        REQUIRE(deadline > now - timer.period());
+        REQUIRE((deadline - start) % timer.period() == std::chrono::nanoseconds { 0 });
+    };
+    runner().get();
+}
+
+TEST_CASE("Cancel - cancel Async sleeping on a timer", "[Timer]")
+{
+    AsyncEvent event;
+    std::atomic<int> value = 0;
+
+    auto coroutine = [&]() -> Async<> {
+        value++;
+        event.signal();
+        co_await sleepFor(std::chrono::hours { 1 });
+        value++;
+    };
+
+    auto runner = [&]() -> Sync<> {
+        auto start = std::chrono::steady_clock::now();
+        auto task = coroutine();
+        co_await event;
+        task.cancel();
+        REQUIRE_THROWS_AS(co_await task, CancellationError);
+        REQUIRE(value == 1);
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::minutes { 1 });
+    };
+    runner().get();
+}
+
+TEST_CASE("Timeout - event wait times out", "[Timer]")
+{
+    AsyncEvent event;
+
+    auto runner = [&]() -> Sync<> {
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE_THROWS_AS(co_await withTimeout(event, std::chrono::milliseconds { 10 }), TimeoutError);
+        REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds { 10 });
+        REQUIRE(event.isWaitListEmpty());
+
+        event.signal();
+        co_await withTimeout(event, std::chrono::milliseconds { 10 });
+    };
+    runner().get();
+}
+
+TEST_CASE("Timeout - sleep wrapped in a timeout", "[Timer]")
+{
+    auto runner = [&]() -> Sync<> {
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE_THROWS_AS(co_await withTimeout(sleepFor(std::chrono::milliseconds { 200 }),
+                              std::chrono::milliseconds { 10 }),
+            TimeoutError);
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds { 200 });
+
+        // the timer thread still runs timers
+        co_await sleepFor(std::chrono::milliseconds { 5 });
+        co_await withTimeout(sleepFor(std::chrono::milliseconds { 5 }), std::chrono::seconds { 10 });
+    };
+    runner().get();
+}
+
+TEST_CASE("Timeout - mutex and value waits time out", "[Timer]")
+{
+    AsyncMutex mutex;
+    AsyncValue<int> value;
+    AsyncEvent locked;
+    AsyncEvent release;
+
+    auto holder = [&]() -> Async<> {
+        auto lock = co_await mutex;
+        locked.signal();
+        co_await release;
+    };
+
+    auto runner = [&]() -> Sync<> {
+        auto task = holder();
+        co_await locked;
+        REQUIRE_THROWS_AS(co_await withTimeout(mutex, std::chrono::milliseconds { 5 }), TimeoutError);
+        REQUIRE(mutex.isWaitListEmpty());
+        release.signal();
+        {
+            auto lock = co_await withTimeout(mutex, std::chrono::seconds { 10 });
+            (void)lock;
+        }
+        co_await task;
+
+        REQUIRE_THROWS_AS(co_await withTimeout(value, std::chrono::milliseconds { 5 }), TimeoutError);
+        value.setAndSignal(7);
+        REQUIRE(co_await withTimeout(value, std::chrono::milliseconds { 5 }) == 7);
+    };
+    runner().get();
+}
+
+TEST_CASE("Timeout - barrier wait times out without breaking the barrier", "[Timer]")
+{
+    AsyncBarrier barrier { 3 };
+    std::atomic<int> cancelledCount = 0;
+
+    auto peer = [&](int maxSpinMicroseconds) -> Async<> {
+        auto start = std::chrono::steady_clock::now();
+        auto spin = std::chrono::microseconds { maxSpinMicroseconds > 0 ? rand() % maxSpinMicroseconds : 0 };
+        while (std::chrono::steady_clock::now() - start < spin) { }
+        try {
+            co_await barrier;
+        } catch (const CancellationError&) {
+            cancelledCount++;
+        }
+    };
+
+    auto timedWait = [&](std::chrono::nanoseconds timeout) -> Async<bool> {
+        try {
+            co_await withTimeout(barrier, timeout);
+        } catch (const TimeoutError&) {
+            co_return true;
+        }
+        co_return false;
+    };
+
+    auto runner = [&]() -> Sync<bool> {
+        auto first = peer(0);
+        auto timedOut = co_await timedWait(std::chrono::milliseconds { 5 });
+        // the remaining arrivals still release the peer
+        auto second = peer(0);
+        co_await barrier;
+        co_await first;
+        co_await second;
+        co_return timedOut;
+    };
+    REQUIRE(runner().get());
+    REQUIRE(cancelledCount == 0);
+    REQUIRE(!barrier.isCanceled());
+    REQUIRE(barrier.isWaitListEmpty());
+
+    // timeouts racing the arrival that completes the barrier
+    AsyncBarrier pairBarrier { 2 };
+    auto pairPeer = [&]() -> Async<> {
+        auto start = std::chrono::steady_clock::now();
+        auto spin = std::chrono::microseconds { rand() % 3000 };
+        while (std::chrono::steady_clock::now() - start < spin) { }
+        co_await pairBarrier;
+    };
+    auto pairRunner = [&]() -> Sync<int> {
+        int timedOutCount = 0;
+        for (int i = 0; i < 200; i++) {
+            auto task = pairPeer();
+            bool timedOut = false;
+            try {
+                co_await withTimeout(pairBarrier, std::chrono::milliseconds { 1 });
+            } catch (const TimeoutError&) {
+                timedOut = true;
+            }
+            if (timedOut) {
+                timedOutCount++;
+                co_await pairBarrier;
+            }
+            co_await task;
+        }
+        co_return timedOutCount;
+    };
+    auto timedOutCount = pairRunner().get();
+    REQUIRE(timedOutCount > 0);
+    REQUIRE(!pairBarrier.isCanceled());
+    REQUIRE(pairBarrier.isWaitListEmpty());
+    REQUIRE(pairBarrier.waitListedCount() == 0);
+}
+
+TEST_CASE("Timeout - timed out coroutine is not cancelled", "[Timer]")
+{
+    std::atomic<int> value = 0;
+
+    auto slow = [&]() -> Async<int> {
+        co_await sleepFor(std::chrono::milliseconds { 50 });
+        value++;
+        co_return 1;
+    };
+
+    auto runner = [&]() -> Sync<> {
+        auto task = slow();
+        REQUIRE_THROWS_AS(co_await withTimeout(task, std::chrono::milliseconds { 5 }), TimeoutError);
+        REQUIRE(value == 0);
+        REQUIRE(co_await task == 1);
+        REQUIRE(value == 1);
+    };
+    runner().get();
+}
+
+}
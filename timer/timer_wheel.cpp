@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <limits>
+
+#include "timer_wheel.hpp"
+
+namespace Levelz::Async {
+
+TimerNode::TimerNode() noexcept
+    : m_previous { nullptr }
+    , m_next { nullptr }
+    , m_expiryTick { 0 }
+    , m_level { -1 }
+    , m_slot { -1 }
+    , m_isLinked { false }
+{
+}
+
+uint64_t TimerNode::expiryTick() const noexcept
+{
+    return m_expiryTick;
+}
+
+void TimerNode::setExpiryTick(uint64_t expiryTick) noexcept
+{
+    assert(!m_isLinked);
+    m_expiryTick = expiryTick;
+}
+
+TimerNode* TimerNode::next() const noexcept
+{
+    return m_next;
+}
+
+bool TimerNode::isLinked() const noexcept
+{
+    return m_isLinked;
+}
+
+TimerWheel::TimerWheel(uint64_t currentTick) noexcept
+    : m_slots {}
+    , m_occupied {}
+    , m_currentTick { currentTick }
+    , m_count { 0 }
+{
+}
+
+bool TimerWheel::insert(TimerNode* node) noexcept
+{
+    assert(!node->m_isLinked);
+    if (node->m_expiryTick <= m_currentTick)
+        return false;
+    link(node);
+    m_count++;
+    return true;
+}
+
+bool TimerWheel::remove(TimerNode* node) noexcept
+{
+    if (!node->m_isLinked)
+        return false;
+    unlink(node);
+    m_count--;
+    return true;
+}
+
+TimerNode* TimerWheel::advance(uint64_t tick) noexcept
+{
+    TimerNode* expired = nullptr;
+    TimerNode* expiredTail = nullptr;
+    while (m_currentTick < tick) {
+        // ticks without expiring or cascading slots are skipped
+        auto nextTick = nextEventTick();
+        if (nextTick > tick) {
+            m_currentTick = tick;
+            break;
+        }
+        m_currentTick = nextTick;
+        processTick(nextTick, expired, expiredTail);
+    }
+    return expired;
+}
+
+uint64_t TimerWheel::nextEventTick() const noexcept
+{
+    auto nextTick = std::numeric_limits<uint64_t>::max();
+    for (int level = 0; level < s_levelCount; ++level) {
+        auto occupied = m_occupied[level];
+        if (!occupied)
+            continue;
+
+        auto shift = s_slotBits * level;
+        auto currentSlot = static_cast<int>((m_currentTick >> shift) & s_slotMask);
+        // A node in a higher level's current slot belongs to its next rotation,
+        // so distances run from 1 to 64 with 64 being the current slot.
+        auto distance = static_cast<uint64_t>(std::countr_zero(std::rotr(occupied, currentSlot + 1))) + 1;
+        // level 0 slots expire, higher level slots cascade when their range starts
+        auto tick = level == 0 ? m_currentTick + distance : ((m_currentTick >> shift) + distance) << shift;
+        nextTick = std::min(nextTick, tick);
+    }
+    return nextTick;
+}
+
+uint64_t TimerWheel::currentTick() const noexcept
+{
+    return m_currentTick;
+}
+
+uint64_t TimerWheel::count() const noexcept
+{
+    return m_count;
+}
+
+bool TimerWheel::isEmpty() const noexcept
+{
+    return m_count == 0;
+}
+
+void TimerWheel::link(TimerNode* node) noexcept
+{
+    assert(node->m_expiryTick > m_currentTick);
+    // nodes beyond the wheel's range wait in the farthest slot and are placed again when it cascades
+    auto expiryTick = std::min(node->m_expiryTick, m_currentTick + s_maxDelta);
+    auto delta = expiryTick - m_currentTick;
+
+    int level = 0;
+    while (delta >> (s_slotBits * (level + 1)))
+        level++;
+    assert(level < s_levelCount);
+    auto slot = static_cast<int>((expiryTick >> (s_slotBits * level)) & s_slotMask);
+
+    auto& head = m_slots[level][slot];
+    node->m_previous = nullptr;
+    node->m_next = head;
+    if (head)
+        head->m_previous = node;
+    head = node;
+    node->m_level = level;
+    node->m_slot = slot;
+    node->m_isLinked = true;
+    m_occupied[level] |= uint64_t { 1 } << slot;
+}
+
+void TimerWheel::unlink(TimerNode* node) noexcept
+{
+    assert(node->m_isLinked);
+    auto& head = m_slots[node->m_level][node->m_slot];
+    if (node->m_previous)
+        node->m_previous->m_next = node->m_next;
+    else
+        head = node->m_next;
+    if (node->m_next)
+        node->m_next->m_previous = node->m_previous;
+    if (!head)
+        m_occupied[node->m_level] &= ~(uint64_t { 1 } << node->m_slot);
+
+    node->m_previous = nullptr;
+    node->m_next = nullptr;
+    node->m_isLinked = false;
+}
+
+// expired nodes are appended so a late advance returns them in expiry order
+void TimerWheel::processTick(uint64_t tick, TimerNode*& expired, TimerNode*& expiredTail) noexcept
+{
+    // cascade from the coarsest level so nodes can drop through several levels in one tick
+    for (int level = s_levelCount - 1; level >= 0; --level) {
+        auto shift = s_slotBits * level;
+        if (level > 0 && (tick & ((uint64_t { 1 } << shift) - 1)) != 0)
+            continue;
+
+        auto slot = static_cast<int>((tick >> shift) & s_slotMask);
+        auto* node = m_slots[level][slot];
+        m_slots[level][slot] = nullptr;
+        m_occupied[level] &= ~(uint64_t { 1 } << slot);
+
+        while (node) {
+            auto* next = node->m_next;
+            node->m_isLinked = false;
+            if (node->m_expiryTick <= tick) {
+                node->m_previous = nullptr;
+                node->m_next = nullptr;
+                if (expiredTail)
+                    expiredTail->m_next = node;
+                else
+                    expired = node;
+                expiredTail = node;
+                m_count--;
+            } else {
+                link(node);
+            }
+            node = next;
+        }
+    }
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef LEVELZ_TIMER_WHEEL_HPP
+#define LEVELZ_TIMER_WHEEL_HPP
+
+#include <array>
+#include <cinttypes>
+
+namespace Levelz::Async {
+
+struct Coroutine;
+
+struct TimerNode {
+    TimerNode() noexcept;
+
+    TimerNode(const TimerNode&) = delete;
+    TimerNode(TimerNode&&) = delete;
+    TimerNode& operator=(const TimerNode&) = delete;
+    TimerNode& operator=(TimerNode&&) = delete;
+
+    uint64_t expiryTick() const noexcept;
+    void setExpiryTick(uint64_t expiryTick) noexcept;
+    TimerNode* next() const noexcept;
+    bool isLinked() const noexcept;
+
+private:
+    friend struct TimerWheel;
+
+    TimerNode* m_previous;
+    TimerNode* m_next;
+    uint64_t m_expiryTick;
+    int m_level;
+    int m_slot;
+    bool m_isLinked;
+};
+
+// Hierarchical timing wheel (Varghese & Lauck) with four levels of 64 slots.
+// Insert and remove are O(1); a node far in the future sits in a coarse slot
+// and cascades to finer levels as time advances. Not thread safe.
+struct TimerWheel {
+    explicit TimerWheel(uint64_t currentTick = 0) noexcept;
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel(TimerWheel&&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+    TimerWheel& operator=(TimerWheel&&) = delete;
+
+    // Returns false without inserting if the node's expiry tick has passed
+    [[nodiscard]] bool insert(TimerNode* node) noexcept;
+    // Returns false if the node is not in the wheel
+    bool remove(TimerNode* node) noexcept;
+    // Moves the wheel to tick and returns the expired nodes linked through
+    // next() in expiry order
+    TimerNode* advance(uint64_t tick) noexcept;
+    // The next tick at which advance has work to do, UINT64_MAX when empty
+    uint64_t nextEventTick() const noexcept;
+    uint64_t currentTick() const noexcept;
+    uint64_t count() const noexcept;
+    bool isEmpty() const noexcept;
+
+private:
+    void link(TimerNode* node) noexcept;
+    void unlink(TimerNode* node) noexcept;
+    void processTick(uint64_t tick, TimerNode*& expired, TimerNode*& expiredTail) noexcept;
+
+    static constexpr int s_levelCount = 4;
+    static constexpr int s_slotBits = 6;
+    static constexpr int s_slotCount = 1 << s_slotBits;
+    static constexpr uint64_t s_slotMask = s_slotCount - 1;
+    static constexpr uint64_t s_maxDelta = (uint64_t { 1 } << (s_slotBits * s_levelCount)) - 1;
+
+    std::array<std::array<TimerNode*, s_slotCount>, s_levelCount> m_slots;
+    // bit i is set when slot i of the level is not empty
+    std::array<uint64_t, s_levelCount> m_occupied;
+    uint64_t m_currentTick;
+    uint64_t m_count;
+};
+
+}
+
+#endif // LEVELZ_TIMER_WHEEL_HPP
@@ -0,0 +1,83 @@
+#include "work_item.hpp"
+
+namespace Levelz::Async {
+
+namespace {
+    constexpr int s_maxCachedItemCount = 256;
+
+    // Freed items of this thread, linked through their first bytes. Items
+    // posted on one thread usually finish on another, so caches fill up on
+    // the running threads and past the limit the memory goes back to the heap.
+    struct ItemCache {
+        ~ItemCache()
+        {
+            while (head) {
+                auto* memory = head;
+                head = *static_cast<void**>(memory);
+                ::operator delete(memory);
+            }
+        }
+
+        void* head = nullptr;
+        int count = 0;
+    };
+
+    thread_local ItemCache s_itemCache;
+}
+
+WorkItem::WorkItem(ThreadPool& threadPool) noexcept
+    : Coroutine { nullptr, false, TaskKind::WorkItem, ThreadPoolKind::Current, &threadPool }
+    , m_storage {}
+    , m_invoke { nullptr }
+    , m_destroy { nullptr }
+{
+}
+
+void* WorkItem::allocate() noexcept
+{
+    static_assert(alignof(WorkItem) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    auto& cache = s_itemCache;
+    if (!cache.head)
+        return ::operator new(sizeof(WorkItem), std::nothrow);
+
+    auto* memory = cache.head;
+    cache.head = *static_cast<void**>(memory);
+    cache.count--;
+    return memory;
+}
+
+void WorkItem::release(WorkItem* workItem) noexcept
+{
+    if (workItem->m_destroy)
+        workItem->m_destroy(workItem->m_storage);
+    workItem->~WorkItem();
+
+    void* memory = workItem;
+    auto& cache = s_itemCache;
+    if (cache.count == s_maxCachedItemCount) {
+        ::operator delete(memory);
+        return;
+    }
+    *static_cast<void**>(memory) = cache.head;
+    cache.head = memory;
+    cache.count++;
+}
+
+// An exception leaves through ThreadPool::resume, which treats it as fatal
+// like one escaping a coroutine. The item is freed either way.
+void WorkItem::run()
+{
+    struct Release {
+        ~Release()
+        {
+            release(workItem);
+        }
+
+        WorkItem* workItem;
+    } releaseOnExit { this };
+
+    if (!isCancelled())
+        m_invoke(m_storage);
+}
+
+}
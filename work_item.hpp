@@ -0,0 +1,100 @@
+#ifndef LEVELZ_WORK_ITEM_HPP
+#define LEVELZ_WORK_ITEM_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "coroutine.hpp"
+#include "thread_pool.hpp"
+
+namespace Levelz::Async {
+
+// A plain callable queued and run like a coroutine, with no coroutine frame
+// or promise. It takes the posting thread's priority and deadline, runs once
+// and frees itself. Cancelled items, posted during shutdown or past their
+// deadline, are freed without running. An exception escaping the callable
+// ends the process, as one escaping a coroutine does.
+//
+// Every item is the same size and freed items are kept in a per-thread cache
+// for the next post. Callables that fit the inline buffer live in the item,
+// larger ones take a separate allocation.
+struct WorkItem final : Coroutine {
+    WorkItem(const WorkItem&) = delete;
+    WorkItem(WorkItem&&) = delete;
+    WorkItem& operator=(const WorkItem&) = delete;
+    WorkItem& operator=(WorkItem&&) = delete;
+
+    // nullptr when memory ran out or copying the callable threw
+    template <typename Function>
+    static WorkItem* create(ThreadPool& threadPool, Function&& function) noexcept
+    {
+        using Callable = std::decay_t<Function>;
+        static_assert(std::is_invocable_v<Callable&>);
+
+        auto* memory = allocate();
+        if (!memory)
+            return nullptr;
+        auto* workItem = new (memory) WorkItem { threadPool };
+        try {
+            if constexpr (sizeof(Callable) <= s_inlineSize && alignof(Callable) <= alignof(std::max_align_t)) {
+                new (workItem->m_storage) Callable(std::forward<Function>(function));
+                workItem->m_invoke = [](void* storage) { (*static_cast<Callable*>(storage))(); };
+                workItem->m_destroy = [](void* storage) noexcept { static_cast<Callable*>(storage)->~Callable(); };
+            } else {
+                auto* callable = new Callable(std::forward<Function>(function));
+                new (workItem->m_storage) Callable* { callable };
+                workItem->m_invoke = [](void* storage) { (**static_cast<Callable**>(storage))(); };
+                workItem->m_destroy = [](void* storage) noexcept { delete *static_cast<Callable**>(storage); };
+            }
+        } catch (...) {
+            release(workItem);
+            return nullptr;
+        }
+        return workItem;
+    }
+
+private:
+    friend struct Coroutine;
+
+    using Invoke = void (*)(void* storage);
+    using Destroy = void (*)(void* storage) noexcept;
+
+    explicit WorkItem(ThreadPool& threadPool) noexcept;
+    ~WorkItem() = default;
+
+    static void* allocate() noexcept;
+    static void release(WorkItem* workItem) noexcept;
+    void run();
+
+    static constexpr size_t s_inlineSize = 6 * sizeof(void*);
+
+    alignas(std::max_align_t) std::byte m_storage[s_inlineSize];
+    Invoke m_invoke;
+    Destroy m_destroy;
+};
+
+// Runs function on the thread pool, fire and forget. Returns false, without
+// running function, when memory ran out or copying function threw.
+template <typename Function>
+[[nodiscard]] bool post(ThreadPool& threadPool, Function&& function) noexcept
+{
+    auto* workItem = WorkItem::create(threadPool, std::forward<Function>(function));
+    if (!workItem)
+        return false;
+    workItem->schedule();
+    return true;
+}
+
+// Runs function on the current thread pool, or the default one off the pools
+template <typename Function>
+[[nodiscard]] bool post(Function&& function) noexcept
+{
+    auto* threadPool = ThreadPool::currentThreadPool();
+    return post(threadPool ? *threadPool : ThreadPool::defaultThreadPool(), std::forward<Function>(function));
+}
+
+}
+
+#endif // LEVELZ_WORK_ITEM_HPP
@@ -0,0 +1,239 @@
+#ifndef LEVELZ_WORK_STEALING_DEQUE_HPP
+#define LEVELZ_WORK_STEALING_DEQUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cinttypes>
+
+namespace Levelz::Async {
+
+// Chase-Lev work stealing deque (Lê et al. "Correct and Efficient Work-Stealing
+// for Weak Memory Models"). The owning thread pushes and pops at the bottom
+// (LIFO) without read-modify-write operations except when racing for the last
+// element; other threads steal from the top (FIFO) with a single CAS.
+template <typename Node>
+struct WorkStealingDeque {
+    WorkStealingDeque()
+        : WorkStealingDeque { s_initialCapacity }
+    {
+    }
+
+    explicit WorkStealingDeque(int64_t initialCapacity)
+        : m_top { 0 }
+        , m_bottom { 0 }
+        , m_buffer { new Buffer { initialCapacity, nullptr } }
+    {
+        assert(initialCapacity > 0 && (initialCapacity & (initialCapacity - 1)) == 0);
+    }
+
+    ~WorkStealingDeque()
+    {
+        auto* buffer = m_buffer.load(std::memory_order_relaxed);
+        while (buffer) {
+            auto* previous = buffer->previous();
+            delete buffer;
+            buffer = previous;
+        }
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque(WorkStealingDeque&&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(WorkStealingDeque&&) = delete;
+
+    // owner only
+    void push(Node* node) noexcept
+    {
+        auto bottom = m_bottom.load(std::memory_order_relaxed);
+        auto top = m_top.load(std::memory_order_acquire);
+        auto* buffer = m_buffer.load(std::memory_order_relaxed);
+        if (bottom - top > buffer->capacity() - 1) {
+            buffer = buffer->grow(bottom, top);
+            m_buffer.store(buffer, std::memory_order_release);
+        }
+        buffer->put(bottom, node);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // owner only, pushes count nodes linked through next() and publishes them together
+    void pushChain(Node* first, uint64_t count) noexcept
+    {
+        auto bottom = m_bottom.load(std::memory_order_relaxed);
+        auto* buffer = reserve(bottom, static_cast<int64_t>(count));
+
+        auto* node = first;
+        for (uint64_t i = 0; i < count; ++i) {
+            assert(node);
+            auto* next = node->next();
+            node->setNext(nullptr);
+            buffer->put(bottom + static_cast<int64_t>(i), node);
+            node = next;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + static_cast<int64_t>(count), std::memory_order_relaxed);
+    }
+
+    // owner only
+    Node* pop() noexcept
+    {
+        auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        auto* buffer = m_buffer.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        auto* node = buffer->get(bottom);
+        if (top == bottom) {
+            if (!m_top.compare_exchange_strong(top, top + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed))
+                node = nullptr;
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return node;
+    }
+
+    // any thread, may fail spuriously when racing with other thieves
+    Node* steal() noexcept
+    {
+        auto top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom)
+            return nullptr;
+
+        auto* buffer = m_buffer.load(std::memory_order_acquire);
+        auto* node = buffer->get(top);
+        if (!m_top.compare_exchange_strong(top, top + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return node;
+    }
+
+    // Steals up to half of the nodes (at most maxCount), returns the oldest one
+    // and moves the rest onto destination, which must be owned by the caller.
+    // Every node still costs a CAS on m_top: the owner pops without a CAS
+    // while it sees the top below its bottom, so claiming a range with one CAS
+    // could take nodes the owner is popping at the same time. What is batched
+    // is the destination side, the moved nodes are published with a single
+    // store of its bottom.
+    Node* stealHalf(WorkStealingDeque& destination, uint64_t maxCount) noexcept
+    {
+        assert(&destination != this);
+        auto limit = std::min((count() + 1) / 2, maxCount);
+        auto* first = steal();
+        if (!first)
+            return nullptr;
+        if (limit <= 1)
+            return first;
+
+        auto bottom = destination.m_bottom.load(std::memory_order_relaxed);
+        auto* buffer = destination.reserve(bottom, static_cast<int64_t>(limit - 1));
+        int64_t movedCount = 0;
+        for (uint64_t i = 1; i < limit; ++i) {
+            auto* node = steal();
+            if (!node)
+                break;
+            buffer->put(bottom + movedCount++, node);
+        }
+        if (movedCount > 0) {
+            std::atomic_thread_fence(std::memory_order_release);
+            destination.m_bottom.store(bottom + movedCount, std::memory_order_relaxed);
+        }
+        return first;
+    }
+
+    bool isEmpty() const noexcept
+    {
+        return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+    }
+
+    uint64_t count() const noexcept
+    {
+        auto bottom = m_bottom.load(std::memory_order_relaxed);
+        auto top = m_top.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<uint64_t>(bottom - top) : 0;
+    }
+
+private:
+    struct Buffer;
+
+    // owner only, returns a buffer with room for count more nodes at bottom
+    Buffer* reserve(int64_t bottom, int64_t count)
+    {
+        auto top = m_top.load(std::memory_order_acquire);
+        auto* buffer = m_buffer.load(std::memory_order_relaxed);
+        while (bottom - top + count > buffer->capacity()) {
+            buffer = buffer->grow(bottom, top);
+            m_buffer.store(buffer, std::memory_order_release);
+        }
+        return buffer;
+    }
+
+    struct Buffer {
+        Buffer(int64_t capacity, Buffer* previous)
+            : m_capacity { capacity }
+            , m_mask { capacity - 1 }
+            , m_nodes { new std::atomic<Node*>[capacity] }
+            , m_previous { previous }
+        {
+        }
+
+        ~Buffer()
+        {
+            delete[] m_nodes;
+        }
+
+        int64_t capacity() const noexcept
+        {
+            return m_capacity;
+        }
+
+        Buffer* previous() const noexcept
+        {
+            return m_previous;
+        }
+
+        Node* get(int64_t index) const noexcept
+        {
+            return m_nodes[index & m_mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, Node* node) noexcept
+        {
+            m_nodes[index & m_mask].store(node, std::memory_order_relaxed);
+        }
+
+        // Thieves may still be reading the old buffer, so it is retired rather
+        // than freed and released together with the deque.
+        Buffer* grow(int64_t bottom, int64_t top)
+        {
+            auto* buffer = new Buffer { 2 * m_capacity, this };
+            for (auto i = top; i < bottom; ++i)
+                buffer->put(i, get(i));
+            return buffer;
+        }
+
+    private:
+        const int64_t m_capacity;
+        const int64_t m_mask;
+        std::atomic<Node*>* const m_nodes;
+        Buffer* const m_previous;
+    };
+
+    alignas(64) std::atomic<int64_t> m_top;
+    alignas(64) std::atomic<int64_t> m_bottom;
+    std::atomic<Buffer*> m_buffer;
+
+    static constexpr int64_t s_initialCapacity = 256;
+};
+
+}
+
+#endif // LEVELZ_WORK_STEALING_DEQUE_HPP
@@ -0,0 +1,145 @@
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+#include <vector>
+
+#include "work_stealing_deque.hpp"
+
+namespace Levelz::Async::Test {
+
+namespace {
+struct Item {
+    int value = 0;
+    Item* m_next = nullptr;
+    std::atomic<int> takenCount = 0;
+
+    Item* next() const noexcept
+    {
+        return m_next;
+    }
+
+    void setNext(Item* next) noexcept
+    {
+        m_next = next;
+    }
+};
+}
+
+TEST_CASE("WorkStealingDeque - owner pops newest, thieves steal oldest", "[WorkStealingDeque]")
+{
+    WorkStealingDeque<Item> deque { 4 };
+    std::vector<Item> items(1000);
+    for (int i = 0; i < 1000; i++) {
+        items[i].value = i;
+        deque.push(&items[i]);
+    }
+    REQUIRE(deque.count() == 1000);
+
+    REQUIRE(deque.pop()->value == 999);
+    REQUIRE(deque.steal()->value == 0);
+    REQUIRE(deque.steal()->value == 1);
+    for (int i = 998; i >= 2; i--)
+        REQUIRE(deque.pop()->value == i);
+    REQUIRE(deque.isEmpty());
+    REQUIRE(!deque.pop());
+    REQUIRE(!deque.steal());
+}
+
+TEST_CASE("WorkStealingDeque - push chain publishes the nodes in order", "[WorkStealingDeque]")
+{
+    WorkStealingDeque<Item> deque { 4 };
+    std::vector<Item> items(10);
+    for (int i = 0; i < 10; i++) {
+        items[i].value = i;
+        items[i].setNext(i > 0 && i + 1 < 10 ? &items[i + 1] : nullptr);
+    }
+    deque.push(&items[0]);
+    deque.pushChain(&items[1], 9);
+    REQUIRE(deque.count() == 10);
+
+    for (int i = 0; i < 10; i++) {
+        auto* item = deque.steal();
+        REQUIRE(item->value == i);
+        REQUIRE(!item->next());
+    }
+    REQUIRE(deque.isEmpty());
+}
+
+TEST_CASE("WorkStealingDeque - steal half moves the older half", "[WorkStealingDeque]")
+{
+    WorkStealingDeque<Item> victim { 4 };
+    WorkStealingDeque<Item> thief { 4 };
+    std::vector<Item> items(20);
+    for (int i = 0; i < 20; i++) {
+        items[i].value = i;
+        victim.push(&items[i]);
+    }
+
+    auto* first = victim.stealHalf(thief, 64);
+    REQUIRE(first->value == 0);
+    REQUIRE(victim.count() == 10);
+    REQUIRE(thief.count() == 9);
+    for (int i = 1; i < 10; i++)
+        REQUIRE(thief.steal()->value == i);
+
+    first = victim.stealHalf(thief, 3);
+    REQUIRE(first->value == 10);
+    REQUIRE(thief.count() == 2);
+    REQUIRE(thief.pop()->value == 12);
+    REQUIRE(thief.pop()->value == 11);
+    REQUIRE(victim.count() == 7);
+
+    WorkStealingDeque<Item> empty;
+    REQUIRE(!empty.stealHalf(thief, 64));
+    REQUIRE(thief.isEmpty());
+}
+
+TEST_CASE("WorkStealingDeque - every node is taken once under contention", "[WorkStealingDeque]")
+{
+    constexpr int itemCount = 200000;
+    constexpr int thiefCount = 3;
+    WorkStealingDeque<Item> deque { 16 };
+    std::vector<Item> items(itemCount);
+    std::atomic<int> takenCount = 0;
+    std::atomic<bool> done = false;
+
+    auto take = [&](Item* item) {
+        item->takenCount++;
+        takenCount++;
+    };
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < thiefCount; t++) {
+        thieves.emplace_back([&, t] {
+            WorkStealingDeque<Item> own { 16 };
+            while (!done || !deque.isEmpty()) {
+                auto* item = t == 0 ? deque.steal() : deque.stealHalf(own, 8);
+                if (item)
+                    take(item);
+                while (auto* ownItem = own.pop())
+                    take(ownItem);
+            }
+        });
+    }
+
+    for (int i = 0; i < itemCount; i++) {
+        deque.push(&items[i]);
+        if (i % 3 == 0) {
+            if (auto* item = deque.pop())
+                take(item);
+        }
+    }
+    while (auto* item = deque.pop())
+        take(item);
+    done = true;
+    for (auto& thief : thieves)
+        thief.join();
+
+    REQUIRE(takenCount == itemCount);
+    bool takenOnce = true;
+    for (auto& item : items)
+        takenOnce = takenOnce && item.takenCount == 1;
+    REQUIRE(takenOnce);
+}
+
+}
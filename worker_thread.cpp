@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <memory>
+#include <system_error>
+
+#include "worker_thread.hpp"
+
+namespace Levelz::Async {
+
+WorkerThread::WorkerThread(std::function<void()> function, size_t stackSize)
+    : m_thread {}
+    , m_isJoinable { false }
+{
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    // below the minimum pthread_attr_setstacksize fails
+    if (stackSize > 0)
+        pthread_attr_setstacksize(&attributes, std::max(stackSize, static_cast<size_t>(PTHREAD_STACK_MIN)));
+
+    auto argument = std::make_unique<std::function<void()>>(std::move(function));
+    auto error = pthread_create(&m_thread, &attributes, &WorkerThread::run, argument.get());
+    pthread_attr_destroy(&attributes);
+    if (error)
+        throw std::system_error { error, std::generic_category(), "pthread_create" };
+    (void)argument.release();
+    m_isJoinable = true;
+}
+
+WorkerThread::WorkerThread(WorkerThread&& other) noexcept
+    : m_thread { other.m_thread }
+    , m_isJoinable { other.m_isJoinable }
+{
+    other.m_isJoinable = false;
+}
+
+WorkerThread& WorkerThread::operator=(WorkerThread&& other) noexcept
+{
+    assert(!m_isJoinable);
+    m_thread = other.m_thread;
+    m_isJoinable = other.m_isJoinable;
+    other.m_isJoinable = false;
+    return *this;
+}
+
+WorkerThread::~WorkerThread()
+{
+    assert(!m_isJoinable);
+}
+
+void WorkerThread::join() noexcept
+{
+    assert(m_isJoinable);
+    pthread_join(m_thread, nullptr);
+    m_isJoinable = false;
+}
+
+bool WorkerThread::isThread(pthread_t thread) const noexcept
+{
+    return m_isJoinable && pthread_equal(m_thread, thread);
+}
+
+void* WorkerThread::run(void* argument) noexcept
+{
+    std::unique_ptr<std::function<void()>> function { static_cast<std::function<void()>*>(argument) };
+    (*function)();
+    return nullptr;
+}
+
+}
@@ -0,0 +1,34 @@
+#ifndef LEVELZ_WORKER_THREAD_HPP
+#define LEVELZ_WORKER_THREAD_HPP
+
+#include <cstddef>
+#include <functional>
+#include <pthread.h>
+
+namespace Levelz::Async {
+
+// A joinable thread with a configurable stack size, which std::thread lacks
+struct WorkerThread {
+    // stackSize zero means the platform default
+    WorkerThread(std::function<void()> function, size_t stackSize);
+
+    WorkerThread(const WorkerThread&) = delete;
+    WorkerThread& operator=(const WorkerThread&) = delete;
+    WorkerThread(WorkerThread&& other) noexcept;
+    WorkerThread& operator=(WorkerThread&& other) noexcept;
+
+    ~WorkerThread();
+
+    void join() noexcept;
+    bool isThread(pthread_t thread) const noexcept;
+
+private:
+    static void* run(void* argument) noexcept;
+
+    pthread_t m_thread;
+    bool m_isJoinable;
+};
+
+}
+
+#endif // LEVELZ_WORKER_THREAD_HPP
@@ -0,0 +1,54 @@
+#ifndef LEVELZ_YIELD_AWAITER_HPP
+#define LEVELZ_YIELD_AWAITER_HPP
+
+#include <coroutine>
+
+#include "awaiter.hpp"
+#include "coroutine.hpp"
+#include "thread_pool.hpp"
+
+namespace Levelz::Async {
+
+// co_await yield() suspends the coroutine and requeues it behind the work
+// already pending on its worker, without growing the stack
+struct Yield {
+};
+
+inline Yield yield() noexcept
+{
+    return {};
+}
+
+struct YieldAwaiter : Awaiter {
+    explicit YieldAwaiter(Coroutine& coroutine) noexcept
+        : Awaiter { coroutine, AwaiterKind::Yield }
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        auto suspensionAdvice = Awaiter::onReady();
+        if (suspensionAdvice == Awaiter::SuspensionAdvice::shouldNotSuspend)
+            return true;
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> awaitingCoroutine) noexcept
+    {
+        auto suspensionAdvice = Awaiter::onSuspend(awaitingCoroutine);
+        if (suspensionAdvice == Awaiter::SuspensionAdvice::shouldNotSuspend)
+            return false;
+
+        coroutine().threadPool().scheduleYielded(&coroutine());
+        return true;
+    }
+
+    void await_resume()
+    {
+        Awaiter::onResume();
+    }
+};
+
+}
+
+#endif // LEVELZ_YIELD_AWAITER_HPP